@@ -0,0 +1,484 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stoat_loader.h"
+
+#include "../src/types.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "../src/datagen/format/stoatformat.h"
+#include "../src/datagen/format/games.h"
+#include "../src/datagen/format/stoatpack.h"
+#include "../src/eval/nnue.h"
+#include "../src/protocol/handler.h"
+#include "../src/util/rng.h"
+
+namespace stoat::loader {
+    namespace {
+        constexpr u32 kMaxFeatures = STOAT_LOADER_MAX_FEATURES;
+
+        // samples are handed over to the shuffle buffer in chunks, to keep locking rare
+        constexpr usize kChunkSize = 1024;
+        constexpr usize kMinShuffleBufferSize = kChunkSize * 2;
+
+        constexpr usize kReadBufferSize = 1024 * 1024;
+        constexpr usize kRecordsPerRead = kReadBufferSize / sizeof(datagen::format::StoatformatRecord);
+
+        struct Sample {
+            std::array<std::array<u16, kMaxFeatures>, 2> features;
+            std::array<u8, 2> featureCounts;
+            u8 stm;
+            i16 score;
+            u8 wdl;
+        };
+
+        static_assert(eval::nnue::kColorStride * 2 <= std::numeric_limits<u16>::max());
+
+        // Returns false if the record does not describe a sensible position
+        [[nodiscard]] bool extractFeatures(const datagen::format::StoatformatRecord& record, Sample& dst) {
+            static constexpr u128 kOccMask = (u128{1} << Squares::kCount) - 1;
+
+            if ((record.occ[0] & record.occ[1] & kOccMask) != 0) {
+                return false;
+            }
+
+            const auto wdl = static_cast<u8>(record.occ[0] >> 88) & 0x3;
+            if (wdl > 2) {
+                return false;
+            }
+
+            util::StaticVector<std::pair<Square, Piece>, kMaxFeatures> pieces{};
+            std::array<u32, Colors::kCount> kingCounts{};
+
+            KingPair kings{};
+
+            for (const auto c : {Colors::kBlack, Colors::kWhite}) {
+                auto bb = Bitboard{record.occ[c.idx()] & kOccMask};
+                while (!bb.empty()) {
+                    if (pieces.size() == kMaxFeatures) {
+                        return false;
+                    }
+
+                    const auto sq = bb.popLsb();
+                    const auto pt = record.pieces[pieces.size()];
+
+                    if (pt >= PieceTypes::kCount) {
+                        return false;
+                    }
+
+                    const auto piece = PieceType::fromRaw(pt).withColor(c);
+
+                    if (piece.type() == PieceTypes::kKing) {
+                        kings.squares[c.idx()] = sq;
+                        ++kingCounts[c.idx()];
+                    }
+
+                    pieces.push({sq, piece});
+                }
+            }
+
+            if (kingCounts[0] != 1 || kingCounts[1] != 1) {
+                return false;
+            }
+
+            std::array<Hand, Colors::kCount> hands{
+                Hand::fromRaw(static_cast<u32>(record.occ[0] >> 96)),
+                Hand::fromRaw(static_cast<u32>(record.occ[1] >> 96)),
+            };
+
+            for (const auto& hand : hands) {
+                for (const auto pt : kHandPieces) {
+                    if (hand.count(pt) > maxPiecesInHand(pt)) {
+                        return false;
+                    }
+                }
+            }
+
+            for (const auto perspective : {Colors::kBlack, Colors::kWhite}) {
+                auto& features = dst.features[perspective.idx()];
+                u32 count = 0;
+
+                for (const auto& [sq, piece] : pieces) {
+                    features[count++] = eval::nnue::psqtFeatureIndex(perspective, kings, piece, sq);
+                }
+
+                for (const auto handColor : {Colors::kBlack, Colors::kWhite}) {
+                    const auto& hand = hands[handColor.idx()];
+                    for (const auto pt : kHandPieces) {
+                        for (u32 i = 0; i < hand.count(pt); ++i) {
+                            if (count == kMaxFeatures) {
+                                return false;
+                            }
+
+                            features[count++] = eval::nnue::handFeatureIndex(perspective, pt, handColor, i);
+                        }
+                    }
+                }
+
+                dst.featureCounts[perspective.idx()] = count;
+            }
+
+            dst.stm = record.stm().raw();
+            dst.score = record.score;
+            dst.wdl = wdl;
+
+            return true;
+        }
+
+        class Loader {
+        public:
+            explicit Loader(const StoatLoaderOptions& options) :
+                    m_threadCount{std::max<u32>(options.threads, 1)},
+                    m_loop{options.loop != 0},
+                    m_bufferCapacity{std::max<usize>(options.shuffleBufferSize, kMinShuffleBufferSize)},
+                    m_rng{options.seed} {
+                m_paths.reserve(options.pathCount);
+
+                for (u32 i = 0; i < options.pathCount; ++i) {
+                    m_paths.emplace_back(options.paths[i]);
+                }
+
+                m_buffer.reserve(m_bufferCapacity + kChunkSize * 2);
+            }
+
+            ~Loader() {
+                {
+                    const std::scoped_lock lock{m_mutex};
+                    m_stop = true;
+                }
+
+                m_spaceSignal.notify_all();
+
+                for (auto& thread : m_threads) {
+                    thread.join();
+                }
+            }
+
+            void start() {
+                m_activeWorkers = m_threadCount;
+
+                m_threads.reserve(m_threadCount);
+                for (u32 id = 0; id < m_threadCount; ++id) {
+                    m_threads.emplace_back([this, id] { runWorker(id); });
+                }
+            }
+
+            [[nodiscard]] u32 next(StoatBatch& batch) {
+                std::unique_lock lock{m_mutex};
+
+                u32 filled = 0;
+
+                while (filled < batch.capacity) {
+                    // only draw from a (nearly) full buffer, or positions would barely be shuffled
+                    if (m_buffer.size() < drawThreshold() && m_activeWorkers > 0) {
+                        m_spaceSignal.notify_all();
+                        m_dataSignal.wait(lock, [this] {
+                            return m_buffer.size() >= drawThreshold() || m_activeWorkers == 0;
+                        });
+                    }
+
+                    if (m_buffer.empty()) {
+                        break;
+                    }
+
+                    const auto idx = m_rng.nextU32(m_buffer.size());
+
+                    writeSample(batch, filled++, m_buffer[idx]);
+
+                    m_buffer[idx] = m_buffer.back();
+                    m_buffer.pop_back();
+                }
+
+                lock.unlock();
+                m_spaceSignal.notify_all();
+
+                batch.size = filled;
+                return filled;
+            }
+
+            [[nodiscard]] u64 skipped() const {
+                return m_skipped.load(std::memory_order::relaxed);
+            }
+
+        private:
+            std::vector<std::string> m_paths{};
+
+            u32 m_threadCount;
+            bool m_loop;
+
+            std::vector<std::thread> m_threads{};
+
+            std::mutex m_mutex{};
+            std::condition_variable m_spaceSignal{};
+            std::condition_variable m_dataSignal{};
+
+            std::vector<Sample> m_buffer{};
+            usize m_bufferCapacity;
+
+            u32 m_activeWorkers{};
+            bool m_stop{};
+
+            util::rng::Jsf64Rng m_rng;
+
+            std::atomic<u64> m_skipped{};
+
+            // producers fill the buffer up to its capacity plus at most one chunk, and the
+            // consumer leaves a chunk's worth of room, so neither side can wait on the other forever
+            [[nodiscard]] usize drawThreshold() const {
+                return m_bufferCapacity - kChunkSize;
+            }
+
+            static void writeSample(StoatBatch& batch, u32 idx, const Sample& sample) {
+                auto* indices = batch.indices + static_cast<usize>(idx) * 2 * kMaxFeatures;
+
+                for (u32 perspective = 0; perspective < 2; ++perspective) {
+                    const auto count = sample.featureCounts[perspective];
+
+                    std::copy_n(sample.features[perspective].begin(), count, indices);
+                    std::fill(indices + count, indices + kMaxFeatures, -1);
+
+                    indices += kMaxFeatures;
+                }
+
+                batch.stm[idx] = sample.stm;
+                batch.score[idx] = sample.score;
+                batch.wdl[idx] = sample.wdl;
+            }
+
+            // Returns false if the loader is shutting down
+            [[nodiscard]] bool push(std::vector<Sample>& chunk) {
+                std::unique_lock lock{m_mutex};
+
+                m_spaceSignal.wait(lock, [this] { return m_buffer.size() < m_bufferCapacity || m_stop; });
+
+                if (m_stop) {
+                    return false;
+                }
+
+                m_buffer.insert(m_buffer.end(), chunk.begin(), chunk.end());
+                chunk.clear();
+
+                lock.unlock();
+                m_dataSignal.notify_one();
+
+                return true;
+            }
+
+            void runWorker(u32 id) {
+                std::vector<Sample> chunk{};
+                chunk.reserve(kChunkSize * 2);
+
+                std::vector<char> readBuffer(kReadBufferSize);
+
+                bool running = true;
+
+                do {
+                    u64 samples = 0;
+
+                    for (usize fileIdx = id; running && fileIdx < m_paths.size(); fileIdx += m_threadCount) {
+                        const auto& path = m_paths[fileIdx];
+
+                        std::ifstream stream{};
+                        stream.rdbuf()->pubsetbuf(readBuffer.data(), static_cast<std::streamsize>(readBuffer.size()));
+                        stream.open(path, std::ios::binary);
+
+                        if (!stream) {
+                            fmt::println(stderr, "failed to open training data file \"{}\"", path);
+                            continue;
+                        }
+
+                        if (const auto gameFormat = datagen::format::gameFormatFromPath(path)) {
+                            running = readGames(path, *gameFormat, stream, chunk, samples);
+                        } else {
+                            running = readStoatformat(stream, chunk, samples);
+                        }
+                    }
+
+                    // stop looping over files with nothing usable in them
+                    if (samples == 0) {
+                        break;
+                    }
+                } while (running && m_loop);
+
+                if (running && !chunk.empty()) {
+                    running = push(chunk);
+                }
+
+                {
+                    const std::scoped_lock lock{m_mutex};
+                    --m_activeWorkers;
+                }
+
+                m_dataSignal.notify_all();
+            }
+
+            [[nodiscard]] bool readStoatformat(std::istream& stream, std::vector<Sample>& chunk, u64& samples) {
+                std::vector<datagen::format::StoatformatRecord> records(kRecordsPerRead);
+
+                while (stream) {
+                    stream.read(
+                        reinterpret_cast<char*>(records.data()),
+                        static_cast<std::streamsize>(records.size() * sizeof(datagen::format::StoatformatRecord))
+                    );
+
+                    const auto count = static_cast<usize>(stream.gcount()) / sizeof(datagen::format::StoatformatRecord);
+
+                    for (usize i = 0; i < count; ++i) {
+                        auto& sample = chunk.emplace_back();
+
+                        if (!extractFeatures(records[i], sample)) {
+                            chunk.pop_back();
+                            m_skipped.fetch_add(1, std::memory_order::relaxed);
+                            continue;
+                        }
+
+                        ++samples;
+
+                        if (chunk.size() >= kChunkSize && !push(chunk)) {
+                            return false;
+                        }
+                    }
+                }
+
+                return true;
+            }
+
+            [[nodiscard]] bool readGames(
+                const std::string& path,
+                datagen::format::GameFormat gameFormat,
+                std::istream& stream,
+                std::vector<Sample>& chunk,
+                u64& samples
+            ) {
+                const auto reader = datagen::format::createReader(gameFormat, stream);
+                datagen::format::StoatpackGame game{};
+
+                while (true) {
+                    const auto result = reader->next(game);
+
+                    if (result == datagen::format::ReadResult::kEnd) {
+                        break;
+                    } else if (result != datagen::format::ReadResult::kOk) {
+                        // nothing after a bad game can be trusted
+                        fmt::println(
+                            stderr,
+                            "{} game in \"{}\" at byte {}, skipping rest of file",
+                            result == datagen::format::ReadResult::kTruncated ? "truncated" : "malformed",
+                            path,
+                            reader->validBytes()
+                        );
+                        m_skipped.fetch_add(1, std::memory_order::relaxed);
+                        break;
+                    }
+
+                    const auto gameStart = chunk.size();
+                    bool valid = true;
+
+                    const auto error = datagen::format::replay(game, [&](const Position& pos, Move move, Score score) {
+                        ST_UNUSED(move);
+
+                        if (!valid) {
+                            return;
+                        }
+
+                        const auto record = datagen::format::StoatformatRecord::pack(pos, static_cast<i16>(score), game.outcome);
+                        valid = extractFeatures(record, chunk.emplace_back());
+                    });
+
+                    if (error || !valid) {
+                        chunk.resize(gameStart);
+                        m_skipped.fetch_add(1, std::memory_order::relaxed);
+                        continue;
+                    }
+
+                    samples += chunk.size() - gameStart;
+
+                    if (chunk.size() >= kChunkSize && !push(chunk)) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+        };
+    } // namespace
+
+} // namespace stoat::loader
+
+namespace stoat::protocol {
+    // never actually used, but the search references it
+    const IProtocolHandler& currHandler() {
+        static EngineState s_state{};
+        static const auto s_handler = createHandler(kDefaultHandler, s_state);
+        return *s_handler;
+    }
+} // namespace stoat::protocol
+
+struct StoatLoader {
+    explicit StoatLoader(const StoatLoaderOptions& options) :
+            loader{options} {}
+
+    stoat::loader::Loader loader;
+};
+
+extern "C" {
+StoatLoader* stoat_loader_open(const StoatLoaderOptions* options) {
+    if (!options || (options->pathCount > 0 && !options->paths)) {
+        fmt::println(stderr, "invalid loader options");
+        return nullptr;
+    }
+
+    if (options->pathCount == 0) {
+        fmt::println(stderr, "no training data files given");
+        return nullptr;
+    }
+
+    auto* loader = new StoatLoader{*options};
+    loader->loader.start();
+
+    return loader;
+}
+
+uint32_t stoat_loader_next(StoatLoader* loader, StoatBatch* batch) {
+    if (!loader || !batch) {
+        return 0;
+    }
+
+    return loader->loader.next(*batch);
+}
+
+uint64_t stoat_loader_skipped(const StoatLoader* loader) {
+    return loader ? loader->loader.skipped() : 0;
+}
+
+void stoat_loader_close(StoatLoader* loader) {
+    delete loader;
+}
+}
@@ -0,0 +1,85 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C API for loading Stoat training data into sparse feature batches. Features are computed with the
+// engine's own psqtFeatureIndex/handFeatureIndex, so they always match what the network sees in search.
+// Files ending in .spk or .dpk are read as Stoatpack or Deltapack games and replayed, anything else is
+// read as raw Stoatformat records
+
+#if defined(_WIN32)
+    #define STOAT_LOADER_API __declspec(dllexport)
+#else
+    #define STOAT_LOADER_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// active features per perspective - every piece is either on the board or in a hand
+#define STOAT_LOADER_MAX_FEATURES 40
+
+typedef struct StoatLoader StoatLoader;
+
+typedef struct StoatLoaderOptions {
+    const char* const* paths;
+    uint32_t pathCount;
+    // worker threads reading files and computing features
+    uint32_t threads;
+    // positions held for shuffling, at least 2048
+    uint32_t shuffleBufferSize;
+    uint64_t seed;
+    // nonzero to go over the files again instead of ending
+    int32_t loop;
+} StoatLoaderOptions;
+
+// All buffers are owned by the caller and hold capacity positions
+typedef struct StoatBatch {
+    uint32_t capacity;
+    // positions filled in by stoat_loader_next
+    uint32_t size;
+    // [capacity][2][STOAT_LOADER_MAX_FEATURES], black's perspective then white's, unused entries are -1
+    int32_t* indices;
+    // 0 for black, 1 for white
+    uint8_t* stm;
+    // from black's perspective
+    int16_t* score;
+    // 0 for a black loss, 1 for a draw, 2 for a black win
+    uint8_t* wdl;
+} StoatBatch;
+
+// Returns NULL on failure, after printing the reason to stderr
+STOAT_LOADER_API StoatLoader* stoat_loader_open(const StoatLoaderOptions* options);
+
+// Fills the batch with up to batch->capacity shuffled positions, and returns how many.
+// Only returns fewer than batch->capacity once the data has run out, and 0 after that
+STOAT_LOADER_API uint32_t stoat_loader_next(StoatLoader* loader, StoatBatch* batch);
+
+// Number of invalid Stoatformat records and games skipped so far
+STOAT_LOADER_API uint64_t stoat_loader_skipped(const StoatLoader* loader);
+
+STOAT_LOADER_API void stoat_loader_close(StoatLoader* loader);
+
+#ifdef __cplusplus
+}
+#endif
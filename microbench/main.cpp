@@ -0,0 +1,361 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../src/types.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/bench.h"
+#include "../src/eval/nnue.h"
+#include "../src/movegen.h"
+#include "../src/position.h"
+#include "../src/protocol/handler.h"
+#include "../src/see.h"
+#include "../src/ttable.h"
+#include "../src/util/parse.h"
+#include "../src/util/timer.h"
+
+// Microbenchmarks for individual engine primitives, run over the bench positions.
+// Unlike bench, which only reports a single nps figure for the whole search,
+// these report ns/op for each subsystem separately, so a regression can be
+// attributed to (e.g.) movegen rather than the search as a whole
+
+namespace stoat {
+    namespace {
+        constexpr u32 kDefaultTrials = 9;
+        constexpr u32 kWarmupTrials = 2;
+
+        // roughly how long each trial should take, in seconds
+        constexpr f64 kTargetTrialTime = 0.1;
+
+        constexpr usize kTtSizeMib = 16;
+
+        template <typename T>
+        inline void doNotOptimize(const T& value) {
+            asm volatile("" : : "r,m"(value) : "memory");
+        }
+
+        struct BenchPosition {
+            Position pos;
+            movegen::MoveList pseudolegal;
+            movegen::MoveList legal;
+        };
+
+        [[nodiscard]] std::vector<BenchPosition> loadPositions() {
+            std::vector<BenchPosition> positions{};
+            positions.reserve(bench::kBenchSfens.size());
+
+            for (const auto sfen : bench::kBenchSfens) {
+                auto& entry = positions.emplace_back(Position::fromSfen(sfen).take());
+
+                movegen::generateAll<true>(entry.pseudolegal, entry.pos);
+
+                for (const auto move : entry.pseudolegal) {
+                    if (entry.pos.isLegal(move)) {
+                        entry.legal.push(move);
+                    }
+                }
+            }
+
+            return positions;
+        }
+
+        class Runner {
+        public:
+            explicit Runner(u32 trials) :
+                    m_trials{trials} {}
+
+            // func performs one pass over the inputs, and returns the number of ops it performed
+            template <typename F>
+            void run(std::string_view name, F&& func) {
+                // calibrate the number of passes per trial from a single pass
+                const auto calibrationStart = util::Instant::now();
+                doNotOptimize(func());
+                const auto passTime = std::max(calibrationStart.elapsed(), 0.000001);
+
+                const auto passes = std::max<usize>(1, static_cast<usize>(kTargetTrialTime / passTime));
+
+                for (u32 i = 0; i < kWarmupTrials; ++i) {
+                    for (usize pass = 0; pass < passes; ++pass) {
+                        doNotOptimize(func());
+                    }
+                }
+
+                std::vector<f64> results{};
+                results.reserve(m_trials);
+
+                for (u32 trial = 0; trial < m_trials; ++trial) {
+                    usize ops{};
+
+                    const auto start = util::Instant::now();
+
+                    for (usize pass = 0; pass < passes; ++pass) {
+                        ops += func();
+                    }
+
+                    const auto time = start.elapsed();
+
+                    results.push_back(time * 1000000000.0 / static_cast<f64>(ops));
+                }
+
+                std::ranges::sort(results);
+
+                const auto median = results[results.size() / 2];
+
+                fmt::println(
+                    "{:<36} {:>10.2f} ns/op (min {:.2f}, max {:.2f})",
+                    name,
+                    median,
+                    results.front(),
+                    results.back()
+                );
+            }
+
+        private:
+            u32 m_trials;
+        };
+    } // namespace
+
+    namespace protocol {
+        // never actually used, but the search references it
+        const IProtocolHandler& currHandler() {
+            static EngineState s_state{};
+            static const auto s_handler = createHandler(kDefaultHandler, s_state);
+            return *s_handler;
+        }
+    } // namespace protocol
+
+    i32 main(std::span<const std::string_view> args) {
+        std::setvbuf(stdout, nullptr, _IONBF, 0);
+
+        u32 trials = kDefaultTrials;
+
+        if (args.size() >= 2 && (!util::tryParse(trials, args[1]) || trials == 0)) {
+            fmt::println(stderr, "usage: {} [trials]", args[0]);
+            return 1;
+        }
+
+        const auto positions = loadPositions();
+
+        Runner runner{trials};
+
+        runner.run("movegen::generateAll", [&] {
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                movegen::MoveList moves{};
+                movegen::generateAll<true>(moves, pos);
+                doNotOptimize(moves.size());
+            }
+
+            return positions.size();
+        });
+
+        runner.run("movegen::generateLegal", [&] {
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                movegen::MoveList moves{};
+                movegen::generateLegal<true>(moves, pos);
+                doNotOptimize(moves.size());
+            }
+
+            return positions.size();
+        });
+
+        runner.run("Position::isLegal", [&] {
+            usize ops{};
+
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                for (const auto move : pseudolegal) {
+                    doNotOptimize(pos.isLegal(move));
+                }
+
+                ops += pseudolegal.size();
+            }
+
+            return ops;
+        });
+
+        runner.run("Position::applyMove", [&] {
+            usize ops{};
+
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                for (const auto move : legal) {
+                    const auto newPos = pos.applyMove(move);
+                    doNotOptimize(newPos);
+                }
+
+                ops += legal.size();
+            }
+
+            return ops;
+        });
+
+        runner.run("see::see", [&] {
+            usize ops{};
+
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                for (const auto move : legal) {
+                    doNotOptimize(see::see(pos, move, 0));
+                }
+
+                ops += legal.size();
+            }
+
+            return ops;
+        });
+
+        {
+            std::vector<std::string> sfens{};
+            std::vector<PackedSfen> packed{};
+
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                sfens.push_back(pos.sfen());
+
+                if (const auto packedSfen = pos.packSfen()) {
+                    packed.push_back(*packedSfen);
+                }
+            }
+
+            runner.run("Position::sfen", [&] {
+                for (const auto& [pos, pseudolegal, legal] : positions) {
+                    doNotOptimize(pos.sfen());
+                }
+
+                return positions.size();
+            });
+
+            runner.run("Position::fromSfen", [&] {
+                for (const auto& sfen : sfens) {
+                    doNotOptimize(Position::fromSfen(sfen));
+                }
+
+                return sfens.size();
+            });
+
+            runner.run("Position::packSfen", [&] {
+                for (const auto& [pos, pseudolegal, legal] : positions) {
+                    doNotOptimize(pos.packSfen());
+                }
+
+                return positions.size();
+            });
+
+            runner.run("Position::fromPackedSfen", [&] {
+                for (const auto& packedSfen : packed) {
+                    doNotOptimize(Position::fromPackedSfen(packedSfen));
+                }
+
+                return packed.size();
+            });
+        }
+
+        {
+            std::vector<u64> keys{};
+
+            for (const auto& [pos, pseudolegal, legal] : positions) {
+                for (const auto move : legal) {
+                    keys.push_back(pos.applyMove(move).key());
+                }
+            }
+
+            tt::TTable tt{kTtSizeMib};
+            tt.finalize();
+
+            runner.run("TTable::put", [&] {
+                for (const auto key : keys) {
+                    tt.put(key, 0, 0, kNullMove, 1, 0, tt::Flag::kExact, false);
+                }
+
+                return keys.size();
+            });
+
+            runner.run("TTable::probe", [&] {
+                for (const auto key : keys) {
+                    tt::ProbedEntry entry{};
+                    doNotOptimize(tt.probe(entry, key, 0));
+                    doNotOptimize(entry);
+                }
+
+                return keys.size();
+            });
+        }
+
+        {
+            eval::nnue::NnueState nnueState{};
+
+            // includes the cost of the move itself, subtract Position::applyMove
+            runner.run("NnueState::push + applyMove + update", [&] {
+                usize ops{};
+
+                for (const auto& [pos, pseudolegal, legal] : positions) {
+                    nnueState.reset(pos);
+
+                    for (const auto move : legal) {
+                        const auto newPos = pos.applyMove(move, nnueState.push());
+                        nnueState.ensureUpToDate(newPos);
+                        nnueState.pop();
+                    }
+
+                    ops += legal.size();
+                }
+
+                return ops;
+            });
+        }
+
+        {
+            std::vector<eval::nnue::Accumulator> accumulators(positions.size());
+
+            runner.run("Accumulator::reset", [&] {
+                for (usize i = 0; i < positions.size(); ++i) {
+                    accumulators[i].reset(positions[i].pos);
+                    doNotOptimize(accumulators[i]);
+                }
+
+                return positions.size();
+            });
+
+            runner.run("eval::nnue::evaluateAccumulator", [&] {
+                for (usize i = 0; i < positions.size(); ++i) {
+                    doNotOptimize(eval::nnue::evaluateAccumulator(accumulators[i], positions[i].pos.stm()));
+                }
+
+                return positions.size();
+            });
+        }
+
+        return 0;
+    }
+} // namespace stoat
+
+using namespace stoat;
+
+i32 main(i32 argc, char* argv[]) {
+    std::vector<std::string_view> args{};
+    args.reserve(argc);
+
+    for (i32 i = 0; i < argc; ++i) {
+        args.emplace_back(argv[i]);
+    }
+
+    return main(args);
+}
@@ -33,6 +33,18 @@
     #error no arch specified
 #endif
 
+#if defined(ST_SSE_BITBOARD) && __SSE2__
+    #define ST_HAS_SSE_BITBOARD 1
+#else
+    #define ST_HAS_SSE_BITBOARD 0
+#endif
+
+#if defined(ST_COMPACT_SLIDERS)
+    #define ST_HAS_COMPACT_SLIDERS 1
+#else
+    #define ST_HAS_COMPACT_SLIDERS 0
+#endif
+
 namespace stoat {
 #ifdef __cpp_lib_hardware_interference_size
     constexpr auto kCacheLineSize = std::hardware_destructive_interference_size;
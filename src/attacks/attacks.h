@@ -26,7 +26,9 @@
 #include "../core.h"
 #include "../util/multi_array.h"
 
-#if ST_HAS_FAST_PEXT
+#if ST_HAS_COMPACT_SLIDERS
+    #include "sliders/compact.h"
+#elif ST_HAS_FAST_PEXT
     #include "sliders/bmi2.h"
 #else
     #include "sliders/black_magic.h"
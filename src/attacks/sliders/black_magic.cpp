@@ -18,7 +18,7 @@
 
 #include "../../arch.h"
 
-#if !ST_HAS_FAST_PEXT
+#if !ST_HAS_FAST_PEXT && !ST_HAS_COMPACT_SLIDERS
     #include "black_magic.h"
 
 namespace stoat::attacks::sliders::black_magic {
@@ -60,19 +60,6 @@ namespace stoat::attacks::sliders::black_magic {
         }
     } // namespace
 
-    const util::MultiArray<Bitboard, Colors::kCount, kLanceDataTableSize> g_lanceAttacks = {
-        generateAttacks<kLanceDataTableSize, offsets::kNorth>(
-            lanceData(Colors::kBlack),
-            lanceMagics(Colors::kBlack),
-            lanceShifts(Colors::kBlack)
-        ),
-        generateAttacks<kLanceDataTableSize, offsets::kSouth>(
-            lanceData(Colors::kWhite),
-            lanceMagics(Colors::kWhite),
-            lanceShifts(Colors::kWhite)
-        ),
-    };
-
     const std::array<Bitboard, kBishopData.tableSize> g_bishopAttacks = generateAttacks<
         kBishopData.tableSize,
         offsets::kNorthWest,
@@ -27,16 +27,10 @@
 #include "../../util/bits.h"
 #include "../../util/multi_array.h"
 #include "data.h"
+#include "lines.h"
 
 namespace stoat::attacks::sliders {
     namespace black_magic {
-        extern const util::MultiArray<Bitboard, Colors::kCount, kLanceDataTableSize> g_lanceAttacks;
-
-        [[nodiscard]] inline std::span<const Bitboard, kLanceDataTableSize> lanceAttacks(Color c) {
-            assert(c);
-            return g_lanceAttacks[c.idx()];
-        }
-
         extern const std::array<Bitboard, kBishopData.tableSize> g_bishopAttacks;
         extern const std::array<Bitboard, kRookData.tableSize> g_rookAttacks;
 
@@ -46,13 +40,8 @@ namespace stoat::attacks::sliders {
     } // namespace black_magic
 
     [[nodiscard]] inline Bitboard lanceAttacks(Square sq, Color c, Bitboard occ) {
-        const auto& sqData = lanceData(c).squares[sq.idx()];
-
-        const auto magic = black_magic::lanceMagics(c)[sq.idx()];
-        const auto shift = black_magic::lanceShifts(c)[sq.idx()];
-
-        const usize idx = black_magic::calcIdx(occ, sqData.mask, magic, shift);
-        return black_magic::lanceAttacks(c)[sqData.offset + idx];
+        // lances only ever need one ray, which is cheap enough to compute directly
+        return lines::lanceAttacks(sq, c, occ);
     }
 
     [[nodiscard]] inline Bitboard bishopAttacks(Square sq, Bitboard occ) {
@@ -18,7 +18,7 @@
 
 #include "../../arch.h"
 
-#if ST_HAS_FAST_PEXT
+#if ST_HAS_FAST_PEXT && !ST_HAS_COMPACT_SLIDERS
     #include "bmi2.h"
 
 namespace stoat::attacks::sliders::bmi2 {
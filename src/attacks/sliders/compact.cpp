@@ -0,0 +1,79 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../arch.h"
+
+#if ST_HAS_COMPACT_SLIDERS
+    #include "compact.h"
+
+namespace stoat::attacks::sliders::compact {
+    namespace {
+        util::MultiArray<u16, kMaxLineLength, kIndexCount> generateLineAttacks() {
+            util::MultiArray<u16, kMaxLineLength, kIndexCount> dst{};
+
+            for (i32 pos = 0; pos < kMaxLineLength; ++pos) {
+                for (usize idx = 0; idx < kIndexCount; ++idx) {
+                    // the ends of the line always block
+                    const auto blockers = (idx << 1) | 1 | (1 << (kMaxLineLength - 1));
+
+                    auto& attacks = dst[pos][idx];
+
+                    for (i32 target = pos - 1; target >= 0; --target) {
+                        attacks |= 1 << target;
+                        if ((blockers & (1 << target)) != 0) {
+                            break;
+                        }
+                    }
+
+                    for (i32 target = pos + 1; target < kMaxLineLength; ++target) {
+                        attacks |= 1 << target;
+                        if ((blockers & (1 << target)) != 0) {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            return dst;
+        }
+
+        util::MultiArray<Bitboard, kLineCount - 1, kLineMaskCount> generateLineSquares() {
+            util::MultiArray<Bitboard, kLineCount - 1, kLineMaskCount> dst{};
+
+            for (usize lineIdx = 1; lineIdx < kLineCount; ++lineIdx) {
+                const auto stride = kLineStrides[lineIdx];
+
+                for (usize mask = 0; mask < kLineMaskCount; ++mask) {
+                    auto& squares = dst[lineIdx - 1][mask];
+
+                    for (i32 pos = 0; pos < kMaxLineLength; ++pos) {
+                        if ((mask & (1 << pos)) != 0) {
+                            squares |= Bitboard{u128{1} << (pos * stride)};
+                        }
+                    }
+                }
+            }
+
+            return dst;
+        }
+    } // namespace
+
+    const util::MultiArray<u16, kMaxLineLength, kIndexCount> g_lineAttacks = generateLineAttacks();
+    const util::MultiArray<Bitboard, kLineCount - 1, kLineMaskCount> g_lineSquares = generateLineSquares();
+} // namespace stoat::attacks::sliders::compact
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../../types.h"
+
+#include <array>
+
+#include "../../bitboard.h"
+#include "../../core.h"
+#include "../../util/multi_array.h"
+#include "util.h"
+
+// Decomposed slider attacks. Rather than one table entry per (square, occupancy) pair,
+// each slider is split into the lines it moves along (ranks and files for rooks, the two
+// diagonals for bishops), and each line is looked up separately. The up to 7 occupancy
+// bits on a line are gathered into an index with a single 64-bit multiply, the attacks
+// along the line come from a table shared by every line, and are then spread back onto
+// the board. Everything fits in a few tens of KiB, instead of several MiB
+namespace stoat::attacks::sliders {
+    namespace compact {
+        enum class Line : u8 {
+            kRank = 0,
+            kFile,
+            kDiagonal,     // north-east
+            kAntiDiagonal, // north-west
+        };
+
+        constexpr usize kLineCount = 4;
+
+        // distance between consecutive squares on each line
+        constexpr std::array<i32, kLineCount> kLineStrides = {
+            offsets::kEast,
+            offsets::kNorth,
+            offsets::kNorthEast,
+            offsets::kNorthWest,
+        };
+
+        // squares that can block a slider never include the ends of a line, so there are at most 7
+        constexpr i32 kMaxInnerSquares = 7;
+        constexpr usize kIndexCount = usize{1} << kMaxInnerSquares;
+
+        constexpr i32 kMaxLineLength = 9;
+        constexpr usize kLineMaskCount = usize{1} << kMaxLineLength;
+
+        constexpr i32 kGatherShift = 64 - kMaxInnerSquares;
+
+        // Moves the occupancy bit for the i'th inner square of a line, found at bit i * stride,
+        // to bit kGatherShift + i. The partial products never overlap or carry into the index
+        // bits as long as the stride is either 1 or at least kMaxInnerSquares + 1
+        [[nodiscard]] consteval u64 gatherMagic(i32 stride) {
+            if (stride == 1) {
+                return u64{1} << kGatherShift;
+            }
+
+            u64 magic{};
+
+            for (i32 i = 0; i < kMaxInnerSquares; ++i) {
+                magic |= u64{1} << (kGatherShift - (stride - 1) * i);
+            }
+
+            return magic;
+        }
+
+        constexpr std::array<u64, kLineCount> kGatherMagics = {
+            gatherMagic(kLineStrides[0]),
+            gatherMagic(kLineStrides[1]),
+            gatherMagic(kLineStrides[2]),
+            gatherMagic(kLineStrides[3]),
+        };
+
+        struct LineData {
+            // every square on the line, excluding this one
+            Bitboard line;
+            // inner squares of the line, relative to the first of them
+            u64 innerMask;
+            // square index of the first inner square
+            u8 innerShift;
+            // square index of the first square on the line
+            u8 start;
+            // position of this square along the line
+            u8 pos;
+        };
+
+        using SquareLineData = util::MultiArray<LineData, Squares::kCount, kLineCount>;
+
+        consteval SquareLineData generateLineData() {
+            constexpr std::array<std::array<i32, 2>, kLineCount> kDirs = {{
+                {offsets::kWest, offsets::kEast},
+                {offsets::kSouth, offsets::kNorth},
+                {offsets::kSouthWest, offsets::kNorthEast},
+                {offsets::kSouthEast, offsets::kNorthWest},
+            }};
+
+            SquareLineData dst{};
+
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto sq = Square::fromRaw(sqIdx);
+
+                for (usize lineIdx = 0; lineIdx < kLineCount; ++lineIdx) {
+                    const auto [backwards, forwards] = kDirs[lineIdx];
+                    const auto stride = kLineStrides[lineIdx];
+
+                    const auto behind = internal::generateSlidingAttacks(sq, backwards, Bitboards::kEmpty);
+                    const auto ahead = internal::generateSlidingAttacks(sq, forwards, Bitboards::kEmpty);
+
+                    const auto line = behind | ahead;
+                    const auto full = line | Bitboard::fromSquare(sq);
+
+                    const auto start = full.lsb();
+                    const auto length = full.popcount();
+
+                    auto& data = dst[sq.idx()][lineIdx];
+
+                    data.line = line;
+                    data.start = start.raw();
+                    data.pos = static_cast<u8>(behind.popcount());
+                    data.innerShift = static_cast<u8>(start.raw() + stride);
+
+                    for (i32 i = 0; i < length - 2; ++i) {
+                        data.innerMask |= u64{1} << (i * stride);
+                    }
+                }
+            }
+
+            return dst;
+        }
+
+        constexpr auto kLineData = generateLineData();
+
+        // attacks along a line of 9 squares from each position, for each inner occupancy
+        extern const util::MultiArray<u16, kMaxLineLength, kIndexCount> g_lineAttacks;
+
+        // squares on each line other than ranks, relative to its first square
+        extern const util::MultiArray<Bitboard, kLineCount - 1, kLineMaskCount> g_lineSquares;
+
+        template <Line kLine>
+        [[nodiscard]] inline Bitboard lineAttacks(Square sq, Bitboard occ) {
+            constexpr auto kLineIdx = static_cast<usize>(kLine);
+
+            const auto& data = kLineData[sq.idx()][kLineIdx];
+
+            const auto inner = static_cast<u64>(occ.raw() >> data.innerShift) & data.innerMask;
+            const auto idx = (inner * kGatherMagics[kLineIdx]) >> kGatherShift;
+
+            const auto attacks = g_lineAttacks[data.pos][idx];
+
+            if constexpr (kLine == Line::kRank) {
+                return Bitboard{static_cast<u128>(attacks) << data.start};
+            } else {
+                return Bitboard{g_lineSquares[kLineIdx - 1][attacks].raw() << data.start} & data.line;
+            }
+        }
+    } // namespace compact
+
+    [[nodiscard]] inline Bitboard lanceAttacks(Square sq, Color c, Bitboard occ) {
+        return compact::lineAttacks<compact::Line::kFile>(sq, occ) & kEmptyBoardLanceAttacks[c.idx()][sq.idx()];
+    }
+
+    [[nodiscard]] inline Bitboard bishopAttacks(Square sq, Bitboard occ) {
+        return compact::lineAttacks<compact::Line::kDiagonal>(sq, occ)
+             | compact::lineAttacks<compact::Line::kAntiDiagonal>(sq, occ);
+    }
+
+    [[nodiscard]] inline Bitboard rookAttacks(Square sq, Bitboard occ) {
+        return compact::lineAttacks<compact::Line::kRank>(sq, occ)
+             | compact::lineAttacks<compact::Line::kFile>(sq, occ);
+    }
+} // namespace stoat::attacks::sliders
@@ -57,15 +57,6 @@ namespace stoat::attacks::sliders {
                 const auto sq = Square::fromRaw(sqIdx);
                 auto& sqData = dst.squares[sq.idx()];
 
-#if !ST_HAS_FAST_PEXT
-                // lances
-                if (shifts[sq.idx()] == 0) {
-                    sqData.offset = dst.tableSize;
-                    ++dst.tableSize;
-                    continue;
-                }
-#endif
-
                 Bitboard mask{};
 
                 for (const auto dir : {kDirs...}) {
@@ -90,17 +81,11 @@ namespace stoat::attacks::sliders {
         }
     } // namespace internal
 
+#if ST_HAS_FAST_PEXT
+    // without pext, lance attacks are computed directly (see lines.h)
     constexpr std::array<internal::PieceData, Colors::kCount> kLanceData = {
-        internal::generatePieceData<offsets::kNorth>(
-#if !ST_HAS_FAST_PEXT
-            black_magic::lanceShifts(Colors::kBlack)
-#endif
-        ),
-        internal::generatePieceData<offsets::kSouth>(
-#if !ST_HAS_FAST_PEXT
-            black_magic::lanceShifts(Colors::kWhite)
-#endif
-        ),
+        internal::generatePieceData<offsets::kNorth>(),
+        internal::generatePieceData<offsets::kSouth>(),
     };
 
     static_assert(kLanceData[0].tableSize == kLanceData[1].tableSize);
@@ -111,6 +96,7 @@ namespace stoat::attacks::sliders {
     }
 
     constexpr usize kLanceDataTableSize = kLanceData[0].tableSize;
+#endif
 
     constexpr auto kBishopData =
         internal::generatePieceData<offsets::kNorthWest, offsets::kNorthEast, offsets::kSouthWest, offsets::kSouthEast>(
@@ -0,0 +1,68 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../../types.h"
+
+#include "../../bitboard.h"
+#include "../../core.h"
+#include "../../util/bits.h"
+
+// Table-free attacks along files, for when pext is unavailable or slow.
+// Northward rays stop at their lowest blocker, which is isolated with the usual
+// subtraction trick. Southward rays stop at their highest blocker instead, which is
+// found with a bit scan - the board is stored rank by rank, so there is no cheap
+// reversal of a file that would let them use the same trick
+namespace stoat::attacks::sliders::lines {
+    // squares strictly north of sq on its file
+    [[nodiscard]] constexpr u128 northRay(Square sq) {
+        return (Bitboards::kFile9.raw() << (sq.raw() + offsets::kNorth)) & Bitboards::kAll.raw();
+    }
+
+    // squares strictly south of sq on its file
+    [[nodiscard]] constexpr u128 southRay(Square sq) {
+        constexpr i32 kTopSquare = Squares::kCount - 1;
+        return Bitboards::kFile1.raw() >> (kTopSquare - sq.raw() - offsets::kSouth);
+    }
+
+    [[nodiscard]] constexpr Bitboard northAttacks(Square sq, Bitboard occ) {
+        const auto ray = northRay(sq);
+
+        const auto blockers = occ.raw() & ray;
+        const auto first = blockers & -blockers;
+
+        // if there are no blockers, first - 1 is all ones
+        return Bitboard{ray & (first ^ (first - 1))};
+    }
+
+    [[nodiscard]] constexpr Bitboard southAttacks(Square sq, Bitboard occ) {
+        const auto ray = southRay(sq);
+
+        // bit 0 is never above the end of the ray, so it can stand in for a blocker
+        const auto blockers = (occ.raw() & ray) | 1;
+        const auto first = u128{1} << (127 - util::clz(blockers));
+
+        return Bitboard{ray & -first};
+    }
+
+    [[nodiscard]] constexpr Bitboard lanceAttacks(Square sq, Color c, Bitboard occ) {
+        assert(c);
+        return c == Colors::kBlack ? northAttacks(sq, occ) : southAttacks(sq, occ);
+    }
+} // namespace stoat::attacks::sliders::lines
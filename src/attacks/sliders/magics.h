@@ -21,39 +21,10 @@
 #include "../../types.h"
 
 #include <array>
-#include <cassert>
-#include <span>
 
 #include "../../core.h"
 
 namespace stoat::attacks::sliders::black_magic {
-    constexpr std::array kLanceShifts = {
-        // black
-        std::array{
-            121, 121, 121, 121, 121, 121, 121, 121, 121, //
-            122, 122, 122, 122, 122, 122, 122, 122, 122, //
-            123, 123, 123, 123, 123, 123, 123, 123, 123, //
-            124, 124, 124, 124, 124, 124, 124, 124, 124, //
-            125, 125, 125, 125, 125, 125, 125, 125, 125, //
-            126, 126, 126, 126, 126, 126, 126, 126, 126, //
-            127, 127, 127, 127, 127, 127, 127, 127, 127, //
-            0,   0,   0,   0,   0,   0,   0,   0,   0,   //
-            0,   0,   0,   0,   0,   0,   0,   0,   0,   //
-        },
-        // white
-        std::array{
-            0,   0,   0,   0,   0,   0,   0,   0,   0,   //
-            0,   0,   0,   0,   0,   0,   0,   0,   0,   //
-            127, 127, 127, 127, 127, 127, 127, 127, 127, //
-            126, 126, 126, 126, 126, 126, 126, 126, 126, //
-            125, 125, 125, 125, 125, 125, 125, 125, 125, //
-            124, 124, 124, 124, 124, 124, 124, 124, 124, //
-            123, 123, 123, 123, 123, 123, 123, 123, 123, //
-            122, 122, 122, 122, 122, 122, 122, 122, 122, //
-            121, 121, 121, 121, 121, 121, 121, 121, 121, //
-        }
-    };
-
     constexpr std::array kBishopShifts = {
         121, 122, 122, 122, 122, 122, 122, 122, 121, //
         122, 122, 122, 122, 122, 122, 122, 122, 122, //
@@ -78,177 +49,6 @@ namespace stoat::attacks::sliders::black_magic {
         114, 115, 115, 115, 115, 115, 115, 115, 114, //
     };
 
-    constexpr std::array kLanceMagics = {
-        // black
-        std::array{
-            U128(0x802002101300e280, 0x4419000080c0c021),
-            U128(0x8004080881001205, 0x8002404800000400),
-            U128(0x4012080250880, 0x2000400108400001),
-            U128(0x20a0200108182, 0x1408400002404840),
-            U128(0x4001480208800, 0x2100400028301082),
-            U128(0x100c062402132, 0x9201000811410),
-            U128(0x1000b12020600088, 0x2480000400000180),
-            U128(0xe02004100079, 0x2004080140024404),
-            U128(0x100140400880c02, 0x8180000008080000),
-            U128(0x8011811882200a2, 0x2000000046204130),
-            U128(0x82204a203810410, 0x8008110000208082),
-            U128(0x22220148c08024, 0x4000004280480000),
-            U128(0x8000024240801163, 0x20200080001040),
-            U128(0x90200908218c008, 0x200160010840024),
-            U128(0x800080a1082000, 0x8081080008022010),
-            U128(0x1011810891004, 0x88001040010000),
-            U128(0x240280c08100c04, 0xc40020190102180),
-            U128(0x108081504, 0x40100008440c0008),
-            U128(0x3004000114008a10, 0xc00040c310000004),
-            U128(0x3004000114008a10, 0xc00040c310000004),
-            U128(0x2000000481810804, 0x2004120402004000),
-            U128(0x1022828010, 0x7500000100040201),
-            U128(0x407300040104002, 0x808002000003004),
-            U128(0x800008682100428, 0xa580000002000820),
-            U128(0x8004210860a, 0x20800044012000),
-            U128(0x8000001008480801, 0x404c200000000800),
-            U128(0x392004041c4400, 0x4114000081004730),
-            U128(0x4500000102120220, 0x1004056680000008),
-            U128(0x4445000004004a86, 0xe200002040000112),
-            U128(0xa200048206201940, 0x5039290104081204),
-            U128(0x401000803082840c, 0x800200000420020),
-            U128(0x4002445000404808, 0x10020000800000c8),
-            U128(0x1040880010b1010, 0x890048023602020),
-            U128(0x20044008600801, 0x100002202010200),
-            U128(0x8000001008480801, 0x404c200000000800),
-            U128(0x20200100080881, 0x941a02001200000),
-            U128(0x230000000048102, 0x400000801c920148),
-            U128(0x230000000048102, 0x400000801c920148),
-            U128(0x42066000054550, 0x4000000200400082),
-            U128(0x801104c000822a, 0x2a00040088000000),
-            U128(0x82024, 0x1500000000080004),
-            U128(0x82024, 0x1500000000080004),
-            U128(0x2006b08002020908, 0x191800100020800),
-            U128(0x8040220004911a02, 0x1201000002000504),
-            U128(0x2008e0009c800401, 0x141040030008145),
-            U128(0x802002061100141, 0x41b008000591004),
-            U128(0x42066000054550, 0x4000000200400082),
-            U128(0x40400042000044, 0x4195602040402040),
-            U128(0x9000046080000020, 0x28c0004000086000),
-            U128(0x4240200000810014, 0x1050000140006042),
-            U128(0x4c1000000a608012, 0x821000400000000c),
-            U128(0x1600000820800408, 0x22a0004000580202),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x2000804100000000, 0x910002014100c200),
-            U128(0x802002061100141, 0x41b008000591004),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x40400042000044, 0x4195602040402040),
-            U128(0x280101040, 0x2100068009200380),
-            U128(0x4240200000810014, 0x1050000140006042),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x802002061100141, 0x41b008000591004),
-            U128(0x4c1000000a608012, 0x821000400000000c),
-            U128(0x280101040, 0x2100068009200380),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-        },
-        //white
-        std::array{
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x0, 0x0),
-            U128(0x408a0400200000, 0x42b0490000428),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x13010000082000, 0x204040400200),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x407300040104002, 0x808002000003004),
-            U128(0x802002061100141, 0x41b008000591004),
-            U128(0x13010000082000, 0x204040400200),
-            U128(0x408a0400200000, 0x42b0490000428),
-            U128(0x40400042000044, 0x4195602040402040),
-            U128(0x4210000000023c, 0x4000000000400400),
-            U128(0x890102040010000, 0x1400401000400),
-            U128(0x408082000414002, 0xa0000000000480),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x46226000101a160, 0x20060000c01075),
-            U128(0x13010000082000, 0x204040400200),
-            U128(0x2006b08002020908, 0x191800100020800),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x401120000000, 0x108000080000048),
-            U128(0x1038080800210018, 0x1100340220a),
-            U128(0x520068c02500a00, 0x840044000900104),
-            U128(0x8008121488008010, 0x9a800800001045),
-            U128(0x8008121488008010, 0x9a800800001045),
-            U128(0x61040a8088480006, 0x201801088),
-            U128(0x111010520000008, 0x108410000140e8),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x2028822248000003, 0x8942260016000080),
-            U128(0x8d18041c68240800, 0x2020043018040c68),
-            U128(0x8008121488008010, 0x9a800800001045),
-            U128(0x20081200800004, 0x4000008001520404),
-            U128(0x100104840a800300, 0x84029089011),
-            U128(0xc003011109002002, 0x80442023100),
-            U128(0xc088090104000, 0x8000080000a),
-            U128(0x8001002080100001, 0x4480042204000b00),
-            U128(0x4800408008100220, 0x40001a0800809018),
-            U128(0x180822080900, 0x1808800042080),
-            U128(0x102c04089214400, 0x40082c4080620000),
-            U128(0x80a101012810008, 0x31010020600),
-            U128(0x8880100221010, 0x4120208100000100),
-            U128(0x410210a00800800, 0x280822068001080),
-            U128(0x3020401c008c200, 0x410048006106800),
-            U128(0x8408020802082, 0x444000080140073),
-            U128(0x1008410008121000, 0x500008100010),
-            U128(0x404011224101020, 0x1800010828944c),
-            U128(0x9010101020090400, 0x9000400820000000),
-            U128(0x2020140053a0, 0x2000020000400000),
-            U128(0x802002101300e280, 0x4419000080c0c021),
-            U128(0xc010100032802042, 0x29060061100020),
-            U128(0x202a000c0410801e, 0x8020280000992048),
-            U128(0x1c4120190090a040, 0x1020000000500000),
-            U128(0x400080c2c2008, 0x21002008000010),
-            U128(0x2008409415102008, 0x100810028000080),
-            U128(0xa09401004211004, 0x48000006004001),
-            U128(0x202014101480, 0xaa09000430052000),
-            U128(0x4121810008285, 0x10030083b070106),
-            U128(0x802002101300e280, 0x4419000080c0c021),
-            U128(0x802002101300e280, 0x4419000080c0c021),
-            U128(0x4012080250880, 0x2000400108400001),
-            U128(0x400102300208003, 0x8800022008086400),
-            U128(0x48000a4080a41022, 0x1000a00060040000),
-            U128(0x100010806040808, 0x1040800290000000),
-            U128(0x1000b12020600088, 0x2480000400000180),
-            U128(0xa00010001c900413, 0x610103000c0000),
-            U128(0x100140400880c02, 0x8180000008080000),
-        },
-    };
-
     constexpr std::array kBishopMagics = {
         U128(0x44040013800200, 0x188000020408420b),   U128(0x10013080081420, 0x4012004506910040),
         U128(0x9024020048010a22, 0x572c10050000143),  U128(0x2408040040121, 0x10402902000),
@@ -336,14 +136,4 @@ namespace stoat::attacks::sliders::black_magic {
         U128(0x8001000004004400, 0x200200080502080),  U128(0x41004104802012, 0x2282000004400002),
         U128(0x1030911410221001, 0x111000010000002),
     };
-
-    [[nodiscard]] constexpr std::span<const i32, Squares::kCount> lanceShifts(Color c) {
-        assert(c);
-        return kLanceShifts[c.idx()];
-    }
-
-    [[nodiscard]] constexpr std::span<const u128, Squares::kCount> lanceMagics(Color c) {
-        assert(c);
-        return kLanceMagics[c.idx()];
-    }
 } // namespace stoat::attacks::sliders::black_magic
@@ -18,76 +18,343 @@
 
 #include "bench.h"
 
-#include <array>
-#include <string_view>
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <span>
+#include <vector>
 
+#include "perf_counters.h"
 #include "position.h"
 #include "search.h"
 #include "stats.h"
 
 namespace stoat::bench {
     namespace {
-        using namespace std::string_view_literals;
-
-        // partially from the USI spec, partially from YaneuraOu
-        constexpr std::array kBenchSfens = {
-            "lnsgkgsnl/1r5b1/ppppppppp/9/9/9/PPPPPPPPP/1B5R1/LNSGKGSNL b - 1"sv,
-            "8l/1l+R2P3/p2pBG1pp/kps1p4/Nn1P2G2/P1P1P2PP/1PS6/1KSG3+r1/LN2+p3L w Sbgn3p 124"sv,
-            "lnsgkgsnl/1r7/p1ppp1bpp/1p3pp2/7P1/2P6/PP1PPPP1P/1B3S1R1/LNSGKG1NL b - 9"sv,
-            "l4S2l/4g1gs1/5p1p1/pr2N1pkp/4Gn3/PP3PPPP/2GPP4/1K7/L3r+s2L w BS2N5Pb 1"sv,
-            "6n1l/2+S1k4/2lp4p/1np1B2b1/3PP4/1N1S3rP/1P2+pPP+p1/1p1G5/3KG2r1 b GSN2L4Pgs2p 1"sv,
-            "l6nl/5+P1gk/2np1S3/p1p4Pp/3P2Sp1/1PPb2P1P/P5GS1/R8/LN4bKL w RGgsn5p 1"sv,
-            "l1r6/4S2k1/p2pb1gsg/5pp2/1pBnp3p/5PP2/PP1P1G1S1/6GKL/L1R5L b Ps3n5p 93"sv,
-            "5+P+B+R1/1kg2+P1+P+R/1g1s2KG1/3g4p/2p1pS3/1+p+l1s4/4B1N1P/9/4P4 b S3N3L9P 221"sv,
-            "ln3g1nl/1r1sg1sk1/p1p1ppbp1/1p1p2p1p/2P6/3P4P/PP2PPPP1/1BRS2SK1/LNG2G1NL b - 23"sv,
-            "l1+R4nk/5rgs1/3pp1gp1/p4pp1l/1p5Pp/4PSP2/P4PNG1/4G4/L5K1L w 2BP2s2n4p 88"sv,
-            "6B1+S/2gg5/4lp1+P1/6p1p/4pP1R1/Ppk1P1P1P/2+p2GK2/5S3/1+n3+r2L b B2SN2L2Pg2n4p 149"sv,
-            "7nl/3+P1kg2/4pb1ps/2r2NP1p/l1P2P1P1/s7P/PN2P4/KGB2G3/1N1R4L w G5P2sl2p 98"sv,
-            "l4Grnl/1B2+B1gk1/p1n3sp1/4ppp1p/P1S2P1P1/1PGP2P1P/3pP2g1/1K4sR1/LN6L w 3Psn 78"sv,
-            "ln6l/2gkgr1s1/1p1pp1n1p/3s1pP2/p8/1P1PBPb2/PS2P1NpP/1K1G2R2/LN1G4L w 3Psp 58"sv,
-            "ln1gk2nl/1rs3g2/p3ppspp/2pp2p2/1p5PP/2P6/PPSPPPP2/2G3SR1/LN2KG1NL b Bb 21"sv,
-            "ln7/1r2g1g2/2pspk1bn/pp1p2PB1/5pp1p/P1P2P3/1PSPP3+l/3K2S2/LN1G1G3 b Srnl3p 59"sv,
-            "4g2nl/5skn1/p1pppp1p1/6p+b1/4P4/3+R1SL1p/P3GPPP1/1+r2SS1KP/3PL2NL w GPbgn2p 128"sv,
-            "lnsgk2nl/1r4gs1/p1pppp1pp/6p2/1p5P1/2P6/PPSPPPP1P/7R1/LN1GKGSNL b Bb 13"sv,
-            "ln1g1gsnl/1r1s2k2/p1pp1p1p1/6p1p/1p7/2P5P/PPS+b1PPP1/2B3K2/LN1GRGSNL w P2p 26"sv,
-            "l2sk2nl/2g2s1g1/2n1pp1pp/pr4p2/1p6P/P2+b+RP1P1/1P2PSP2/5K3/L2G1G1NL b SPbn3p 51"sv,
+        struct RunResult {
+            std::vector<BenchInfo> positions{};
+            usize nodes{};
+            f64 time{};
         };
 
-        constexpr usize kTtSizeMib = 16;
+        struct Summary {
+            f64 median;
+            f64 mean;
+            f64 stddev;
+            f64 min;
+            f64 max;
+        };
+
+        [[nodiscard]] f64 nps(usize nodes, f64 time) {
+            return time > 0.0 ? static_cast<f64>(nodes) / time : 0.0;
+        }
+
+        [[nodiscard]] Summary summarize(std::vector<f64> values) {
+            assert(!values.empty());
+
+            std::ranges::sort(values);
+
+            const auto count = static_cast<f64>(values.size());
+
+            const auto mid = values.size() / 2;
+            const auto median = values.size() % 2 == 0 ? (values[mid - 1] + values[mid]) / 2.0 : values[mid];
+
+            f64 mean{};
+            for (const auto v : values) {
+                mean += v;
+            }
+            mean /= count;
+
+            f64 variance{};
+            for (const auto v : values) {
+                variance += (v - mean) * (v - mean);
+            }
+
+            // sample stddev
+            const auto stddev = values.size() > 1 ? std::sqrt(variance / (count - 1.0)) : 0.0;
+
+            return {
+                .median = median,
+                .mean = mean,
+                .stddev = stddev,
+                .min = values.front(),
+                .max = values.back(),
+            };
+        }
+
+        void printText(const std::vector<RunResult>& runs) {
+            if (runs.size() < 2) {
+                return;
+            }
+
+            std::vector<f64> npsValues{};
+            for (const auto& run : runs) {
+                npsValues.push_back(nps(run.nodes, run.time));
+            }
+
+            const auto summary = summarize(npsValues);
+
+            fmt::println("");
+            fmt::println(
+                "{} runs: median {:.0f} nps, mean {:.0f} nps, stddev {:.0f} ({:.2f}%), min {:.0f}, max {:.0f}",
+                runs.size(),
+                summary.median,
+                summary.mean,
+                summary.stddev,
+                summary.mean > 0.0 ? summary.stddev / summary.mean * 100.0 : 0.0,
+                summary.min,
+                summary.max
+            );
+        }
+
+        void printJson(
+            const BenchOptions& options,
+            std::span<const BenchPosition> positions,
+            const std::vector<RunResult>& runs
+        ) {
+            const auto printSummary = [&](std::string_view name, auto value, bool last) {
+                std::vector<f64> values{};
+                for (const auto& run : runs) {
+                    values.push_back(value(run));
+                }
+
+                const auto summary = summarize(values);
+
+                fmt::println(
+                    R"(  "{}": {{"median": {:.6f}, "mean": {:.6f}, "stddev": {:.6f}, "min": {:.6f}, "max": {:.6f}}}{})",
+                    name,
+                    summary.median,
+                    summary.mean,
+                    summary.stddev,
+                    summary.min,
+                    summary.max,
+                    last ? "" : ","
+                );
+            };
+
+            fmt::println("{{");
+            fmt::println(R"(  "depth": {},)", options.depth);
+            fmt::println(R"(  "threads": {},)", options.threads);
+            fmt::println(R"(  "hash": {},)", options.ttSizeMib);
+            fmt::println(R"(  "runs": [)");
+
+            for (usize runIdx = 0; runIdx < runs.size(); ++runIdx) {
+                const auto& run = runs[runIdx];
+
+                fmt::println("    {{");
+                fmt::println(R"(      "positions": [)");
+
+                for (usize posIdx = 0; posIdx < run.positions.size(); ++posIdx) {
+                    const auto& info = run.positions[posIdx];
+
+                    fmt::println(
+                        R"(        {{"sfen": "{}", "nodes": {}, "time": {:.6f}, "nps": {:.0f}, "depth": {}, "seldepth": {}, "bestmove": "{}"}}{})",
+                        positions[posIdx].sfen,
+                        info.nodes,
+                        info.time,
+                        nps(info.nodes, info.time),
+                        info.depth,
+                        info.seldepth,
+                        info.bestMove,
+                        posIdx + 1 < run.positions.size() ? "," : ""
+                    );
+                }
+
+                fmt::println("      ],");
+                fmt::println(R"(      "nodes": {},)", run.nodes);
+                fmt::println(R"(      "time": {:.6f},)", run.time);
+                fmt::println(R"(      "nps": {:.0f})", nps(run.nodes, run.time));
+                fmt::println("    }}{}", runIdx + 1 < runs.size() ? "," : "");
+            }
+
+            fmt::println("  ],");
+
+            printSummary("nodes", [](const RunResult& run) { return static_cast<f64>(run.nodes); }, false);
+            printSummary("time", [](const RunResult& run) { return run.time; }, false);
+            printSummary("nps", [](const RunResult& run) { return nps(run.nodes, run.time); }, true);
+
+            fmt::println("}}");
+        }
+
+        void printCsv(std::span<const BenchPosition> positions, const std::vector<RunResult>& runs) {
+            fmt::println("run,position,sfen,nodes,time,nps,depth,seldepth,bestmove");
+
+            for (usize runIdx = 0; runIdx < runs.size(); ++runIdx) {
+                const auto& run = runs[runIdx];
+
+                for (usize posIdx = 0; posIdx < run.positions.size(); ++posIdx) {
+                    const auto& info = run.positions[posIdx];
+
+                    fmt::println(
+                        "{},{},{},{},{:.6f},{:.0f},{},{},{}",
+                        runIdx + 1,
+                        posIdx + 1,
+                        positions[posIdx].sfen,
+                        info.nodes,
+                        info.time,
+                        nps(info.nodes, info.time),
+                        info.depth,
+                        info.seldepth,
+                        info.bestMove
+                    );
+                }
+
+                fmt::println("{},total,,{},{:.6f},{:.0f},,,", runIdx + 1, run.nodes, run.time, nps(run.nodes, run.time));
+            }
+
+            std::vector<f64> nodes{};
+            std::vector<f64> times{};
+            std::vector<f64> npsValues{};
+
+            for (const auto& run : runs) {
+                nodes.push_back(static_cast<f64>(run.nodes));
+                times.push_back(run.time);
+                npsValues.push_back(nps(run.nodes, run.time));
+            }
+
+            const auto nodeSummary = summarize(nodes);
+            const auto timeSummary = summarize(times);
+            const auto npsSummary = summarize(npsValues);
+
+            const auto printStat = [](std::string_view name, f64 nodes, f64 time, f64 nps) {
+                fmt::println("{},,,{:.0f},{:.6f},{:.0f},,,", name, nodes, time, nps);
+            };
+
+            printStat("median", nodeSummary.median, timeSummary.median, npsSummary.median);
+            printStat("mean", nodeSummary.mean, timeSummary.mean, npsSummary.mean);
+            printStat("stddev", nodeSummary.stddev, timeSummary.stddev, npsSummary.stddev);
+            printStat("min", nodeSummary.min, timeSummary.min, npsSummary.min);
+            printStat("max", nodeSummary.max, timeSummary.max, npsSummary.max);
+        }
     } // namespace
 
-    void run(i32 depth) {
-        Searcher searcher{kTtSizeMib};
+    bool loadPositions(std::vector<BenchPosition>& dst, const std::optional<std::string>& sfenFile) {
+        if (!sfenFile) {
+            for (const auto sfen : kBenchSfens) {
+                dst.push_back({std::string{sfen}, Position::fromSfen(sfen).take()});
+            }
+
+            return true;
+        }
+
+        std::ifstream stream{*sfenFile};
+
+        if (!stream) {
+            fmt::println(stderr, "failed to open sfen file \"{}\"", *sfenFile);
+            return false;
+        }
+
+        std::string line{};
+        for (usize lineIdx = 1; std::getline(stream, line); ++lineIdx) {
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+                line.pop_back();
+            }
+
+            if (line.empty() || line.starts_with('#')) {
+                continue;
+            }
+
+            auto pos = Position::fromSfen(line);
+
+            if (!pos) {
+                fmt::println(stderr, "invalid sfen on line {}: {}", lineIdx, pos.takeErr().message());
+                return false;
+            }
+
+            dst.push_back({line, pos.take()});
+        }
+
+        if (dst.empty()) {
+            fmt::println(stderr, "no positions in sfen file \"{}\"", *sfenFile);
+            return false;
+        }
+
+        return true;
+    }
+
+    i32 run(const BenchOptions& options) {
+        std::vector<BenchPosition> positions{};
+        if (!loadPositions(positions, options.sfenFile)) {
+            return 1;
+        }
+
+        const bool text = options.format == OutputFormat::kText;
+
+        perf::reset();
+
+        Searcher searcher{options.ttSizeMib};
+
+        if (options.threads != 1) {
+            searcher.setThreadCount(options.threads);
+        }
 
         searcher.setMinimal(true);
-        searcher.ensureReady();
+        searcher.setSilent(!text);
 
-        usize totalNodes{};
-        f64 totalTime{};
+        std::vector<RunResult> runs{};
+        runs.reserve(options.runs);
 
-        auto& thread = searcher.take();
+        for (u32 runIdx = 0; runIdx < options.runs; ++runIdx) {
+            // every run starts from a clean TT and clean histories, so they are comparable
+            searcher.newGame();
 
-        thread.maxDepth = depth;
+            auto& run = runs.emplace_back();
+            run.positions.reserve(positions.size());
 
-        for (const auto sfen : kBenchSfens) {
-            fmt::println("SFEN: {}", sfen);
+            if (text && options.runs > 1) {
+                fmt::println("Run {}/{}", runIdx + 1, options.runs);
+                fmt::println("");
+            }
 
-            thread.reset(Position::fromSfen(sfen).take(), {});
+            for (const auto& [sfen, pos] : positions) {
+                if (text) {
+                    fmt::println("SFEN: {}", sfen);
+                }
 
-            BenchInfo info{};
-            searcher.runBenchSearch(info);
+                auto& info = run.positions.emplace_back();
+                searcher.runBenchSearch(pos, options.depth, info);
 
-            totalNodes += info.nodes;
-            totalTime += info.time;
+                run.nodes += info.nodes;
+                run.time += info.time;
 
-            fmt::println("");
+                if (text) {
+                    fmt::println("");
+                }
+            }
+
+            if (text) {
+                fmt::println("{:.5g} seconds", run.time);
+                fmt::println("{} nodes {} nps", run.nodes, static_cast<usize>(nps(run.nodes, run.time)));
+
+                if (runIdx + 1 < options.runs) {
+                    fmt::println("");
+                }
+            }
         }
 
-        const auto nps = static_cast<usize>(static_cast<f64>(totalNodes) / totalTime);
+        switch (options.format) {
+            case OutputFormat::kText: {
+                printText(runs);
+                stats::print();
 
-        fmt::println("{:.5g} seconds", totalTime);
-        fmt::println("{} nodes {} nps", totalNodes, nps);
+                usize totalNodes{};
+                for (const auto& run : runs) {
+                    totalNodes += run.nodes;
+                }
+
+                perf::print(totalNodes);
+                break;
+            }
+            case OutputFormat::kJson:
+                printJson(options, positions, runs);
+                break;
+            case OutputFormat::kCsv:
+                printCsv(positions, runs);
+                break;
+        }
 
-        stats::print();
+        return 0;
     }
 } // namespace stoat::bench
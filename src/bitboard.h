@@ -22,9 +22,11 @@
 
 #include <array>
 #include <cassert>
+#include <type_traits>
 
 #include "core.h"
 #include "util/bits.h"
+#include "util/sse.h"
 
 namespace stoat {
     namespace offsets {
@@ -49,130 +51,130 @@ namespace stoat {
         constexpr Bitboard() = default;
 
         explicit constexpr Bitboard(u128 bb) :
-                m_bb{bb} {}
+                m_bb{toStorage(bb)} {}
 
         constexpr Bitboard(const Bitboard&) = default;
         constexpr Bitboard(Bitboard&&) = default;
 
         [[nodiscard]] constexpr Bitboard operator&(Bitboard rhs) const {
-            return Bitboard{m_bb & rhs.raw()};
+            return wrap(bitAnd(m_bb, rhs.m_bb));
         }
 
         [[nodiscard]] constexpr Bitboard operator|(Bitboard rhs) const {
-            return Bitboard{m_bb | rhs.raw()};
+            return wrap(bitOr(m_bb, rhs.m_bb));
         }
 
         [[nodiscard]] constexpr Bitboard operator^(Bitboard rhs) const {
-            return Bitboard{m_bb ^ rhs.raw()};
+            return wrap(bitXor(m_bb, rhs.m_bb));
         }
 
         constexpr Bitboard& operator&=(Bitboard rhs) {
-            m_bb &= rhs.raw();
+            m_bb = bitAnd(m_bb, rhs.m_bb);
             return *this;
         }
 
         constexpr Bitboard& operator|=(Bitboard rhs) {
-            m_bb |= rhs.raw();
+            m_bb = bitOr(m_bb, rhs.m_bb);
             return *this;
         }
 
         constexpr Bitboard& operator^=(Bitboard rhs) {
-            m_bb ^= rhs.raw();
+            m_bb = bitXor(m_bb, rhs.m_bb);
             return *this;
         }
 
         [[nodiscard]] constexpr Bitboard operator&(u128 rhs) const {
-            return Bitboard{m_bb & rhs};
+            return wrap(bitAnd(m_bb, toStorage(rhs)));
         }
 
         [[nodiscard]] constexpr Bitboard operator|(u128 rhs) const {
-            return Bitboard{m_bb | rhs};
+            return wrap(bitOr(m_bb, toStorage(rhs)));
         }
 
         [[nodiscard]] constexpr Bitboard operator^(u128 rhs) const {
-            return Bitboard{m_bb ^ rhs};
+            return wrap(bitXor(m_bb, toStorage(rhs)));
         }
 
         constexpr Bitboard& operator&=(u128 rhs) {
-            m_bb &= rhs;
+            m_bb = bitAnd(m_bb, toStorage(rhs));
             return *this;
         }
 
         constexpr Bitboard& operator|=(u128 rhs) {
-            m_bb |= rhs;
+            m_bb = bitOr(m_bb, toStorage(rhs));
             return *this;
         }
 
         constexpr Bitboard& operator^=(u128 rhs) {
-            m_bb ^= rhs;
+            m_bb = bitXor(m_bb, toStorage(rhs));
             return *this;
         }
 
         [[nodiscard]] constexpr Bitboard operator&(i32 rhs) const {
-            return Bitboard{m_bb & static_cast<u128>(rhs)};
+            return wrap(bitAnd(m_bb, toStorage(static_cast<u128>(rhs))));
         }
 
         [[nodiscard]] constexpr Bitboard operator|(i32 rhs) const {
-            return Bitboard{m_bb | static_cast<u128>(rhs)};
+            return wrap(bitOr(m_bb, toStorage(static_cast<u128>(rhs))));
         }
 
         [[nodiscard]] constexpr Bitboard operator^(i32 rhs) const {
-            return Bitboard{m_bb ^ static_cast<u128>(rhs)};
+            return wrap(bitXor(m_bb, toStorage(static_cast<u128>(rhs))));
         }
 
         constexpr Bitboard& operator&=(i32 rhs) {
-            m_bb &= static_cast<u128>(rhs);
+            m_bb = bitAnd(m_bb, toStorage(static_cast<u128>(rhs)));
             return *this;
         }
 
         constexpr Bitboard& operator|=(i32 rhs) {
-            m_bb |= static_cast<u128>(rhs);
+            m_bb = bitOr(m_bb, toStorage(static_cast<u128>(rhs)));
             return *this;
         }
 
         constexpr Bitboard& operator^=(i32 rhs) {
-            m_bb ^= static_cast<u128>(rhs);
+            m_bb = bitXor(m_bb, toStorage(static_cast<u128>(rhs)));
             return *this;
         }
 
         [[nodiscard]] constexpr Bitboard operator~() const {
-            return Bitboard{~m_bb & kAll};
+            return wrap(andNot(toStorage(kAll), m_bb));
         }
 
         [[nodiscard]] constexpr Bitboard operator<<(i32 rhs) const {
-            return Bitboard{m_bb << rhs};
+            return Bitboard{raw() << rhs};
         }
 
         [[nodiscard]] constexpr Bitboard operator>>(i32 rhs) const {
-            return Bitboard{m_bb >> rhs};
+            return Bitboard{raw() >> rhs};
         }
 
         constexpr Bitboard& operator<<=(i32 rhs) {
-            m_bb <<= rhs;
+            m_bb = toStorage(raw() << rhs);
             return *this;
         }
 
         constexpr Bitboard& operator>>=(i32 rhs) {
-            m_bb >>= rhs;
+            m_bb = toStorage(raw() >> rhs);
             return *this;
         }
 
         [[nodiscard]] constexpr bool getSquare(Square square) const {
-            return (m_bb & square.bit()) != 0;
+            return !isZero(bitAnd(m_bb, toStorage(square.bit())));
         }
 
         constexpr Bitboard& setSquare(Square square) {
-            m_bb |= square.bit();
+            m_bb = bitOr(m_bb, toStorage(square.bit()));
             return *this;
         }
 
         constexpr Bitboard& clearSquare(Square square) {
-            m_bb &= ~square.bit();
+            m_bb = andNot(m_bb, toStorage(square.bit()));
             return *this;
         }
 
         constexpr Bitboard& toggleSquare(Square square) {
-            m_bb ^= square.bit();
+            m_bb = bitXor(m_bb, toStorage(square.bit()));
             return *this;
         }
 
@@ -185,20 +187,31 @@ namespace stoat {
         }
 
         constexpr Bitboard& clear() {
-            m_bb = 0;
+            m_bb = toStorage(0);
             return *this;
         }
 
         [[nodiscard]] constexpr i32 popcount() const {
-            return util::popcount(m_bb);
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::popcount(m_bb);
+            }
+#endif
+            return util::popcount(raw());
         }
 
         [[nodiscard]] constexpr bool empty() const {
-            return m_bb == 0;
+            return isZero(m_bb);
         }
 
         [[nodiscard]] constexpr bool multiple() const {
-            return (m_bb & (m_bb - 1)) != 0;
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::multiple(m_bb);
+            }
+#endif
+            const auto bb = raw();
+            return (bb & (bb - 1)) != 0;
         }
 
         [[nodiscard]] constexpr bool one() const {
@@ -206,51 +219,68 @@ namespace stoat {
         }
 
         [[nodiscard]] constexpr Square lsb() const {
-            const auto idx = util::ctz(m_bb);
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return Square::fromRaw(util::sse::ctz(m_bb));
+            }
+#endif
+            const auto idx = util::ctz(raw());
             return Square::fromRaw(idx);
         }
 
         [[nodiscard]] constexpr Bitboard isolateLsb() const {
-            const auto bit = m_bb & -m_bb;
-            return Bitboard{bit};
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return wrap(util::sse::isolateLsb(m_bb));
+            }
+#endif
+            const auto bb = raw();
+            return Bitboard{bb & -bb};
         }
 
         constexpr Square popLsb() {
             const auto square = lsb();
-            m_bb &= m_bb - 1;
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                m_bb = util::sse::clearLsb(m_bb);
+                return square;
+            }
+#endif
+            const auto bb = raw();
+            m_bb = toStorage(bb & (bb - 1));
             return square;
         }
 
         [[nodiscard]] constexpr Bitboard shiftNorth() const {
-            return Bitboard{(m_bb & ~kRankA) << offsets::kNorth};
+            return wrap(shift<offsets::kNorth>(andNot(m_bb, toStorage(kRankA))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftSouth() const {
-            return Bitboard{m_bb >> -offsets::kSouth};
+            return wrap(shift<offsets::kSouth>(m_bb));
         }
 
         [[nodiscard]] constexpr Bitboard shiftWest() const {
-            return Bitboard{(m_bb & ~kFile9) >> -offsets::kWest};
+            return wrap(shift<offsets::kWest>(andNot(m_bb, toStorage(kFile9))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftEast() const {
-            return Bitboard{(m_bb & ~kFile1) << offsets::kEast};
+            return wrap(shift<offsets::kEast>(andNot(m_bb, toStorage(kFile1))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftNorthWest() const {
-            return Bitboard{(m_bb & ~(kRankA | kFile9)) << offsets::kNorthWest};
+            return wrap(shift<offsets::kNorthWest>(andNot(m_bb, toStorage(kRankA | kFile9))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftNorthEast() const {
-            return Bitboard{(m_bb & ~(kRankA | kFile1)) << offsets::kNorthEast};
+            return wrap(shift<offsets::kNorthEast>(andNot(m_bb, toStorage(kRankA | kFile1))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftSouthWest() const {
-            return Bitboard{(m_bb & ~kFile9) >> -offsets::kSouthWest};
+            return wrap(shift<offsets::kSouthWest>(andNot(m_bb, toStorage(kFile9))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftSouthEast() const {
-            return Bitboard{(m_bb & ~kFile1) >> -offsets::kSouthEast};
+            return wrap(shift<offsets::kSouthEast>(andNot(m_bb, toStorage(kFile1))));
         }
 
         [[nodiscard]] constexpr Bitboard shiftNorthRelative(Color c) const {
@@ -327,20 +357,20 @@ namespace stoat {
 
         [[nodiscard]] constexpr Bitboard fillUp() const {
             auto b = m_bb;
-            b |= b << 9;
-            b |= b << 18;
-            b |= b << 36;
-            b |= b << 72;
-            return Bitboard{b & kAll};
+            b = bitOr(b, shift<9>(b));
+            b = bitOr(b, shift<18>(b));
+            b = bitOr(b, shift<36>(b));
+            b = bitOr(b, shift<72>(b));
+            return wrap(bitAnd(b, toStorage(kAll)));
         }
 
         [[nodiscard]] constexpr Bitboard fillDown() const {
             auto b = m_bb;
-            b |= b >> 9;
-            b |= b >> 18;
-            b |= b >> 36;
-            b |= b >> 72;
-            return Bitboard{b & kAll};
+            b = bitOr(b, shift<-9>(b));
+            b = bitOr(b, shift<-18>(b));
+            b = bitOr(b, shift<-36>(b));
+            b = bitOr(b, shift<-72>(b));
+            return wrap(bitAnd(b, toStorage(kAll)));
         }
 
         [[nodiscard]] constexpr Bitboard fillFile() const {
@@ -348,10 +378,17 @@ namespace stoat {
         }
 
         [[nodiscard]] constexpr u128 raw() const {
-            return m_bb;
+            return fromStorage(m_bb);
         }
 
-        [[nodiscard]] constexpr bool operator==(const Bitboard&) const = default;
+        [[nodiscard]] constexpr bool operator==(const Bitboard& rhs) const {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::equal(m_bb, rhs.m_bb);
+            }
+#endif
+            return fromStorage(m_bb) == fromStorage(rhs.m_bb);
+        }
 
         constexpr Bitboard& operator=(const Bitboard&) = default;
         constexpr Bitboard& operator=(Bitboard&&) = default;
@@ -367,7 +404,98 @@ namespace stoat {
         }
 
     private:
-        u128 m_bb{};
+        // With ST_SSE_BITBOARD, the value lives in an SSE register (see util/sse.h)
+        // and is only converted to a u128 for raw(), variable shifts and constant evaluation
+#if ST_HAS_SSE_BITBOARD
+        using Storage = util::sse::Vec;
+#else
+        using Storage = u128;
+#endif
+
+        Storage m_bb{};
+
+        [[nodiscard]] static constexpr Storage toStorage(u128 v) {
+#if ST_HAS_SSE_BITBOARD
+            return util::sse::toVec(v);
+#else
+            return v;
+#endif
+        }
+
+        [[nodiscard]] static constexpr u128 fromStorage(Storage v) {
+#if ST_HAS_SSE_BITBOARD
+            return util::sse::fromVec(v);
+#else
+            return v;
+#endif
+        }
+
+        [[nodiscard]] static constexpr Bitboard wrap(Storage v) {
+            Bitboard bb{};
+            bb.m_bb = v;
+            return bb;
+        }
+
+        [[nodiscard]] static constexpr Storage bitAnd(Storage a, Storage b) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::bitAnd(a, b);
+            }
+#endif
+            return toStorage(fromStorage(a) & fromStorage(b));
+        }
+
+        [[nodiscard]] static constexpr Storage bitOr(Storage a, Storage b) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::bitOr(a, b);
+            }
+#endif
+            return toStorage(fromStorage(a) | fromStorage(b));
+        }
+
+        [[nodiscard]] static constexpr Storage bitXor(Storage a, Storage b) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::bitXor(a, b);
+            }
+#endif
+            return toStorage(fromStorage(a) ^ fromStorage(b));
+        }
+
+        // a & ~b
+        [[nodiscard]] static constexpr Storage andNot(Storage a, Storage b) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::andNot(a, b);
+            }
+#endif
+            return toStorage(fromStorage(a) & ~fromStorage(b));
+        }
+
+        [[nodiscard]] static constexpr bool isZero(Storage v) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::testZero(v);
+            }
+#endif
+            return fromStorage(v) == 0;
+        }
+
+        // positive shifts are towards higher squares
+        template <i32 kShift>
+        [[nodiscard]] static constexpr Storage shift(Storage v) {
+#if ST_HAS_SSE_BITBOARD
+            if (!std::is_constant_evaluated()) {
+                return util::sse::shift<kShift>(v);
+            }
+#endif
+            if constexpr (kShift < 0) {
+                return toStorage(fromStorage(v) >> -kShift);
+            } else {
+                return toStorage(fromStorage(v) << kShift);
+            }
+        }
 
         static constexpr u128 kAll = U128(0x1ffff, 0xffffffffffffffff);
         static constexpr u128 kEmpty = 0;
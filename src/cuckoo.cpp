@@ -0,0 +1,154 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "cuckoo.h"
+
+#include <array>
+#include <exception>
+#include <utility>
+
+#include "attacks/attacks.h"
+#include "keys.h"
+
+namespace stoat::cuckoo {
+    namespace {
+        // there are 8432 move keys, so this keeps the load under the ~50% limit of
+        // two-choice cuckoo hashing, with room to spare
+        constexpr usize kTableSize = 32768;
+
+        // insertion gives up rather than looping forever if the keys ever stop fitting
+        constexpr usize kMaxDisplacements = 1024;
+
+        [[nodiscard]] constexpr usize h1(u64 key) {
+            return key % kTableSize;
+        }
+
+        [[nodiscard]] constexpr usize h2(u64 key) {
+            return (key >> 16) % kTableSize;
+        }
+
+        // pawns, lances and knights can never move back, so their moves cannot repeat a position
+        constexpr std::array kPieceTypes = {
+            PieceTypes::kSilver,
+            PieceTypes::kGold,
+            PieceTypes::kBishop,
+            PieceTypes::kRook,
+            PieceTypes::kKing,
+            PieceTypes::kPromotedPawn,
+            PieceTypes::kPromotedLance,
+            PieceTypes::kPromotedKnight,
+            PieceTypes::kPromotedSilver,
+            PieceTypes::kPromotedBishop,
+            PieceTypes::kPromotedRook,
+        };
+
+        // the slider tables may not be initialised yet, so only use the constexpr ones
+        [[nodiscard]] Bitboard emptyBoardAttacks(PieceType pt, Square sq, Color c) {
+            switch (pt.raw()) {
+                case PieceTypes::kSilver.raw():
+                    return attacks::silverAttacks(sq, c);
+                case PieceTypes::kBishop.raw():
+                    return attacks::sliders::kEmptyBoardBishopAttacks[sq.idx()];
+                case PieceTypes::kRook.raw():
+                    return attacks::sliders::kEmptyBoardRookAttacks[sq.idx()];
+                case PieceTypes::kKing.raw():
+                    return attacks::kingAttacks(sq);
+                case PieceTypes::kPromotedBishop.raw():
+                    return attacks::sliders::kEmptyBoardBishopAttacks[sq.idx()] | attacks::kingAttacks(sq);
+                case PieceTypes::kPromotedRook.raw():
+                    return attacks::sliders::kEmptyBoardRookAttacks[sq.idx()] | attacks::kingAttacks(sq);
+                default:
+                    return attacks::goldAttacks(sq, c);
+            }
+        }
+
+        struct Table {
+            std::array<u64, kTableSize> keys{};
+            std::array<Entry, kTableSize> entries{};
+        };
+
+        Table generateTable() {
+            Table table{};
+
+            usize count = 0;
+
+            for (const auto pt : kPieceTypes) {
+                for (const auto c : {Colors::kBlack, Colors::kWhite}) {
+                    const auto piece = pt.withColor(c);
+
+                    for (i32 aIdx = 0; aIdx < Squares::kCount; ++aIdx) {
+                        const auto a = Square::fromRaw(aIdx);
+
+                        for (i32 bIdx = aIdx + 1; bIdx < Squares::kCount; ++bIdx) {
+                            const auto b = Square::fromRaw(bIdx);
+
+                            if (!emptyBoardAttacks(pt, a, c).getSquare(b)
+                                && !emptyBoardAttacks(pt, b, c).getSquare(a))
+                            {
+                                continue;
+                            }
+
+                            auto key = keys::pieceSquare(piece, a) ^ keys::pieceSquare(piece, b) ^ keys::stm();
+                            Entry entry{piece, a, b};
+
+                            auto slot = h1(key);
+
+                            for (usize displacements = 0;; ++displacements) {
+                                std::swap(table.keys[slot], key);
+                                std::swap(table.entries[slot], entry);
+
+                                if (!entry.piece) {
+                                    break;
+                                }
+
+                                if (displacements == kMaxDisplacements) {
+                                    fmt::println(stderr, "Failed to build cuckoo table - too many displacements");
+                                    std::terminate();
+                                }
+
+                                slot = slot == h1(key) ? h2(key) : h1(key);
+                            }
+
+                            ++count;
+                        }
+                    }
+                }
+            }
+
+            if (count * 2 > kTableSize) {
+                fmt::println(stderr, "Cuckoo table overloaded - {} keys in {} slots", count, kTableSize);
+                std::terminate();
+            }
+
+            return table;
+        }
+
+        const Table s_table = generateTable();
+    } // namespace
+
+    const Entry* find(u64 moveKey) {
+        if (auto slot = h1(moveKey); s_table.keys[slot] == moveKey) {
+            return &s_table.entries[slot];
+        }
+
+        if (auto slot = h2(moveKey); s_table.keys[slot] == moveKey) {
+            return &s_table.entries[slot];
+        }
+
+        return nullptr;
+    }
+} // namespace stoat::cuckoo
@@ -0,0 +1,39 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "types.h"
+
+#include "core.h"
+
+// Cuckoo hash table of the key changes made by single non-capturing,
+// non-promoting board moves of pieces that can move back towards where they
+// came from, for detecting that a position could repeat with one more move.
+// After Marcel van Kervinck's method, as used in chess engines
+namespace stoat::cuckoo {
+    struct Entry {
+        Piece piece{Pieces::kNone};
+        // either square may be the origin of the move
+        Square a{Squares::kNone};
+        Square b{Squares::kNone};
+    };
+
+    // the entry whose move changes the position key by exactly moveKey, if any.
+    // moveKey must include the side to move key
+    [[nodiscard]] const Entry* find(u64 moveKey);
+} // namespace stoat::cuckoo
@@ -0,0 +1,180 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "book.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <string_view>
+
+#include <fmt/std.h>
+
+#include "../util/split.h"
+
+namespace stoat::datagen {
+    namespace {
+        [[nodiscard]] std::optional<Position> parseLine(std::string_view line, std::vector<u64>& keyHistory) {
+            std::vector<std::string_view> parts{};
+            util::split(parts, line);
+
+            assert(!parts.empty());
+
+            const auto movesIdx = std::distance(parts.begin(), std::ranges::find(parts, "moves"));
+
+            Position pos{};
+
+            // the sfen keyword from a USI position command is optional
+            const usize sfenIdx = parts[0] == "sfen" ? 1 : 0;
+
+            if (parts[0] == "startpos") {
+                if (movesIdx != 1) {
+                    return {};
+                }
+
+                pos = Position::startpos();
+            } else if (movesIdx <= sfenIdx) {
+                return {};
+            } else if (auto parsed = Position::fromSfenParts(std::span{parts}.subspan(sfenIdx, movesIdx - sfenIdx))) {
+                pos = parsed.take();
+            } else {
+                return {};
+            }
+
+            keyHistory.clear();
+
+            for (usize i = movesIdx + 1; i < parts.size(); ++i) {
+                auto parsedMove = Move::fromStr(parts[i]);
+
+                if (!parsedMove) {
+                    return {};
+                }
+
+                const auto move = parsedMove.take();
+
+                if (!pos.isPseudolegal(move) || !pos.isLegal(move)) {
+                    return {};
+                }
+
+                keyHistory.push_back(pos.key());
+                pos = pos.applyMove(move);
+            }
+
+            return pos;
+        }
+
+        [[nodiscard]] std::string_view trim(std::string_view line) {
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+                line.remove_suffix(1);
+            }
+
+            while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front()))) {
+                line.remove_prefix(1);
+            }
+
+            return line;
+        }
+
+        [[nodiscard]] bool isEntry(std::string_view line) {
+            return !line.empty() && !line.starts_with('#');
+        }
+    } // namespace
+
+    bool OpeningBook::open(const std::filesystem::path& path) {
+        if (!m_file.open(path)) {
+            return false;
+        }
+
+        if (m_file.data().empty()) {
+            fmt::println(stderr, "opening book \"{}\" is empty", path);
+            return false;
+        }
+
+        // catch a book in the wrong format up front, rather than having every thread
+        // give up on it later. only reads up to the first valid line
+        const auto data = std::string_view{m_file.data().data(), m_file.data().size()};
+        std::vector<u64> keyHistory{};
+
+        usize lineNumber = 0;
+        usize invalidLines = 0;
+
+        for (usize begin = 0; begin < data.size();) {
+            const auto end = std::min(data.find('\n', begin), data.size());
+            const auto line = trim(data.substr(begin, end - begin));
+
+            ++lineNumber;
+
+            if (isEntry(line) && line.size() < kMaxLineLength) {
+                if (parseLine(line, keyHistory)) {
+                    return true;
+                }
+
+                if (++invalidLines <= kMaxReportedInvalidLines) {
+                    fmt::println(stderr, "invalid line {} in opening book \"{}\": {}", lineNumber, path, line);
+                }
+            }
+
+            begin = end + 1;
+        }
+
+        fmt::println(stderr, "opening book \"{}\" has no valid positions", path);
+        return false;
+    }
+
+    std::optional<Position> OpeningBook::sample(util::rng::Jsf64Rng& rng, std::vector<u64>& keyHistory) const {
+        const auto data = m_file.data();
+
+        for (u32 attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            const auto offset = static_cast<usize>((static_cast<u128>(rng.nextU64()) * data.size()) >> 64);
+
+            // find the line this byte belongs to
+            usize begin = offset;
+            while (begin > 0 && data[begin - 1] != '\n' && offset - begin < kMaxLineLength) {
+                --begin;
+            }
+
+            usize end = offset;
+            while (end < data.size() && data[end] != '\n' && end - begin < kMaxLineLength) {
+                ++end;
+            }
+
+            if (end - begin >= kMaxLineLength) {
+                continue;
+            }
+
+            // longer lines are proportionally more likely to be hit, so
+            // accept them with proportionally lower probability to compensate
+            const auto length = end - begin + 1;
+            if (length > kMinLineLength && rng.nextU32(length) >= kMinLineLength) {
+                continue;
+            }
+
+            const auto line = trim(std::string_view{data.data() + begin, end - begin});
+
+            if (!isEntry(line)) {
+                continue;
+            }
+
+            if (auto pos = parseLine(line, keyHistory)) {
+                return pos;
+            }
+        }
+
+        return {};
+    }
+} // namespace stoat::datagen
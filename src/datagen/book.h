@@ -0,0 +1,60 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "../position.h"
+#include "../util/mapped_file.h"
+#include "../util/rng.h"
+
+namespace stoat::datagen {
+    // Samples datagen start positions from a file with one position per line, given the same
+    // way as to a USI position command - "[sfen] <sfen> [moves ...]" or "startpos [moves ...]".
+    // The file is memory-mapped, and besides a check for a valid line when it is
+    // opened, only the sampled lines are ever read
+    class OpeningBook {
+    public:
+        // Fails if the file cannot be opened or does not contain a single valid line
+        // (reporting the first few invalid ones)
+        [[nodiscard]] bool open(const std::filesystem::path& path);
+
+        // Picks a line at random, skipping empty lines, # comments and invalid entries. Every
+        // valid line is equally likely to be picked, as none is shorter than kMinLineLength.
+        // keyHistory is overwritten with the keys of the positions before each move on the line.
+        // Returns nothing if no valid position was found after a large number of attempts
+        [[nodiscard]] std::optional<Position> sample(util::rng::Jsf64Rng& rng, std::vector<u64>& keyHistory)
+            const;
+
+    private:
+        // the shortest valid line, "startpos" and its newline
+        static constexpr usize kMinLineLength = 9;
+        static constexpr usize kMaxLineLength = 4096;
+
+        static constexpr u32 kMaxAttempts = 65536;
+
+        static constexpr usize kMaxReportedInvalidLines = 8;
+
+        util::MappedFile m_file{};
+    };
+} // namespace stoat::datagen
@@ -0,0 +1,140 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "checkpoint.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fmt/ostream.h>
+#include <fmt/std.h>
+
+#include "../util/file_sync.h"
+#include "../util/parse.h"
+#include "../util/split.h"
+
+namespace stoat::datagen {
+    bool Checkpoint::save(const std::filesystem::path& path) const {
+        auto tmpPath = path;
+        tmpPath += ".tmp";
+
+        {
+            std::ofstream stream{tmpPath, std::ios::trunc};
+
+            if (!stream) {
+                fmt::println(stderr, "failed to open checkpoint file \"{}\"", tmpPath);
+                return false;
+            }
+
+            fmt::println(stream, "seed {}", seed);
+            fmt::println(stream, "rng {} {} {} {}", rngState[0], rngState[1], rngState[2], rngState[3]);
+            fmt::println(stream, "games {}", games);
+            fmt::println(stream, "bytes {}", bytes);
+            fmt::println(stream, "options {}", options);
+
+            stream.flush();
+
+            if (!stream) {
+                fmt::println(stderr, "failed to write checkpoint file \"{}\"", tmpPath);
+                return false;
+            }
+        }
+
+        // sync before renaming, so the new checkpoint is complete on disk whenever it is visible
+        if (!util::syncFile(tmpPath)) {
+            return false;
+        }
+
+        std::error_code error{};
+        std::filesystem::rename(tmpPath, path, error);
+
+        if (error) {
+            fmt::println(stderr, "failed to replace checkpoint file \"{}\": {}", path, error.message());
+            return false;
+        }
+
+        auto dir = path.parent_path();
+
+        if (dir.empty()) {
+            dir = ".";
+        }
+
+        return util::syncDirectory(dir);
+    }
+
+    std::optional<Checkpoint> Checkpoint::load(const std::filesystem::path& path) {
+        std::ifstream stream{path};
+
+        if (!stream) {
+            return {};
+        }
+
+        Checkpoint checkpoint{};
+
+        bool hasSeed = false;
+        bool hasRng = false;
+        bool hasGames = false;
+        bool hasBytes = false;
+        bool hasOptions = false;
+
+        std::string line{};
+        std::vector<std::string_view> tokens{};
+
+        while (std::getline(stream, line)) {
+            tokens.clear();
+            util::split(tokens, line);
+
+            if (tokens.empty()) {
+                continue;
+            }
+
+            bool valid = false;
+
+            if (tokens[0] == "seed" && tokens.size() == 2) {
+                valid = hasSeed = util::tryParse(checkpoint.seed, tokens[1]);
+            } else if (tokens[0] == "rng" && tokens.size() == 5) {
+                valid = true;
+                for (usize i = 0; i < checkpoint.rngState.size(); ++i) {
+                    valid &= util::tryParse(checkpoint.rngState[i], tokens[i + 1]);
+                }
+                hasRng = valid;
+            } else if (tokens[0] == "games" && tokens.size() == 2) {
+                valid = hasGames = util::tryParse(checkpoint.games, tokens[1]);
+            } else if (tokens[0] == "bytes" && tokens.size() == 2) {
+                valid = hasBytes = util::tryParse(checkpoint.bytes, tokens[1]);
+            } else if (tokens[0] == "options" && tokens.size() >= 2) {
+                // the rest of the line
+                checkpoint.options = line.substr(static_cast<usize>(tokens[1].data() - line.data()));
+                valid = hasOptions = true;
+            }
+
+            if (!valid) {
+                fmt::println(stderr, "invalid line in checkpoint file \"{}\": {}", path, line);
+                return {};
+            }
+        }
+
+        if (!hasSeed || !hasRng || !hasGames || !hasBytes || !hasOptions) {
+            fmt::println(stderr, "incomplete checkpoint file \"{}\"", path);
+            return {};
+        }
+
+        return checkpoint;
+    }
+} // namespace stoat::datagen
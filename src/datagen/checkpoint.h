@@ -0,0 +1,55 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "../util/rng.h"
+
+namespace stoat::datagen {
+    // The state of a datagen thread between two games. Games only depend on the rng state
+    // they start with, so a thread resumed from a checkpoint reproduces the rest of its
+    // output exactly, provided the options match - resuming with any others is refused.
+    // Stored as text alongside the thread's output file
+    struct Checkpoint {
+        // base seed of the whole run
+        u64 seed{};
+        util::rng::Jsf64Rng::State rngState{};
+        // games written so far, over every run
+        u64 games{};
+        // size of the output file up to the end of the last game
+        u64 bytes{};
+        // every setting that affects the games generated, which must
+        // match for a run to be resumed. A single line of text
+        std::string options{};
+
+        // Writes to a temporary file first, so an interrupted save leaves the old checkpoint intact.
+        // The new file and the rename are synced to disk, so a checkpoint survives a host crash too.
+        // Whatever data the checkpoint refers to must already have been synced
+        bool save(const std::filesystem::path& path) const;
+
+        // Returns nothing if the file does not exist or is invalid, printing
+        // an error in the latter case
+        [[nodiscard]] static std::optional<Checkpoint> load(const std::filesystem::path& path);
+    };
+} // namespace stoat::datagen
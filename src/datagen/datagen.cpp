@@ -21,28 +21,38 @@
 #include <atomic>
 #include <filesystem>
 #include <fstream>
-#include <memory>
 #include <optional>
 #include <thread>
 
 #include <fmt/ostream.h>
 #include <fmt/std.h>
 
+#include "../eval/nnue.h"
 #include "../limit.h"
 #include "../movegen.h"
 #include "../search.h"
 #include "../util/ctrlc.h"
+#include "../util/parse.h"
 #include "../util/rng.h"
 #include "../util/static_vector.h"
 #include "../util/timer.h"
-#include "format/stoatpack.h"
+#include "book.h"
+#include "checkpoint.h"
+#include "mate_solver.h"
+#include "telemetry.h"
+#include "format/games.h"
+#include "writer.h"
 
 namespace stoat::datagen {
     namespace {
         constexpr usize kDatagenTtSizeMib = 16;
         constexpr usize kReportInterval = 512;
+        // seconds between telemetry snapshots
+        constexpr f64 kTelemetryInterval = 10.0;
 
         constexpr usize kBaseRandomMoves = 7;
+        // fewer random moves on top of book positions, just to avoid repeating them exactly
+        constexpr usize kBookRandomMoves = 2;
         constexpr bool kRandomizeStartSide = true;
 
         constexpr usize kSoftNodes = 15000;
@@ -52,6 +62,7 @@ namespace stoat::datagen {
         std::optional<std::ofstream> s_errOut{};
 
         std::atomic_bool s_stop{false};
+        std::atomic_bool s_bookExhausted{false};
 
         std::ofstream& getErrStream(const std::filesystem::path& outDir) {
             if (!s_errOut) {
@@ -72,10 +83,6 @@ namespace stoat::datagen {
                 const auto idx = start + rng.nextU32(moves.size() - start);
                 const auto move = moves[idx];
 
-                if (!pos.isLegal(move)) {
-                    continue;
-                }
-
                 keyHistory.push_back(pos.key());
                 const auto newPos = pos.applyMove(move);
                 const auto sennichite = newPos.testSennichite(false, keyHistory);
@@ -91,30 +98,48 @@ namespace stoat::datagen {
             return kNullMove;
         }
 
-        [[nodiscard]] Position getStartpos(
+        [[nodiscard]] std::optional<Position> getStartpos(
             util::rng::Jsf64Rng& rng,
             std::vector<u64>& keyHistory,
-            format::IDataFormat& format
+            format::IDataFormat& format,
+            const OpeningBook* book
         ) {
-            util::StaticVector<Move, kBaseRandomMoves + kRandomizeStartSide> randomMoves{};
-            util::StaticVector<u64, kBaseRandomMoves + kRandomizeStartSide> newKeys{};
+            static constexpr auto kMaxRandomMoves = std::max(kBaseRandomMoves, kBookRandomMoves) + kRandomizeStartSide;
+
+            util::StaticVector<Move, kMaxRandomMoves> randomMoves{};
+            util::StaticVector<u64, kMaxRandomMoves> newKeys{};
 
+            Position basePos{};
             Position pos{};
 
-            const usize count = kBaseRandomMoves + (kRandomizeStartSide ? (rng.nextU64() >> 63) : 0);
+            const usize count = (book ? kBookRandomMoves : kBaseRandomMoves)
+                              + (kRandomizeStartSide ? (rng.nextU64() >> 63) : 0);
 
             while (true) {
                 randomMoves.clear();
                 newKeys.clear();
 
-                pos = Position::startpos();
+                if (book) {
+                    auto sampled = book->sample(rng, keyHistory);
+
+                    if (!sampled) {
+                        return {};
+                    }
+
+                    basePos = *sampled;
+                } else {
+                    keyHistory.clear();
+                    basePos = Position::startpos();
+                }
+
+                pos = basePos;
 
                 movegen::MoveList moves{};
                 bool failed = false;
 
                 for (usize i = 0; i < count; ++i) {
                     moves.clear();
-                    movegen::generateAll<true>(moves, pos);
+                    movegen::generateLegal<true>(moves, pos);
 
                     const auto move = selectRandomLegal(rng, pos, keyHistory, moves);
 
@@ -136,6 +161,12 @@ namespace stoat::datagen {
 
             std::ranges::copy(newKeys, std::back_inserter(keyHistory));
 
+            if (book) {
+                format.startFromPosition(basePos);
+            } else {
+                format.startStandard();
+            }
+
             for (const auto move : randomMoves) {
                 format.pushUnscored(move);
             }
@@ -143,18 +174,20 @@ namespace stoat::datagen {
             return pos;
         }
 
-        void runThread(u32 id, u64 seed, const std::filesystem::path& outDir) {
-            const auto filename = fmt::format("{}.spk", id);
-            const auto outFile = outDir / filename;
-
-            std::ofstream stream{outFile, std::ios::binary | std::ios::app};
-
-            if (!stream) {
-                fmt::println(stderr, "failed to open output file \"{}\"", outFile);
-                return;
-            }
+        void runThread(
+            u32 id,
+            const Checkpoint& checkpoint,
+            const std::filesystem::path& outDir,
+            AsyncWriter& writer,
+            const OpeningBook* book,
+            u32 mateProbeNodes,
+            format::GameFormat outputFormat,
+            Telemetry::Counters& counters
+        ) {
+            auto& buffer = writer.buffer(id);
 
-            util::rng::Jsf64Rng rng{seed};
+            auto rng = util::rng::Jsf64Rng::fromState(checkpoint.rngState);
+            auto totalGames = checkpoint.games;
 
             Searcher searcher{kDatagenTtSizeMib};
 
@@ -171,9 +204,13 @@ namespace stoat::datagen {
             thread.maxDepth = kMaxDepth;
             thread.datagen = true;
 
-            format::Stoatpack format{};
+            const auto formatPtr = format::createWriter(outputFormat);
+            auto& format = *formatPtr;
+
+            MateSolver mateSolver{};
 
             usize gameCount{};
+            usize adjudicatedGames{};
             usize totalPositions{};
 
             const auto start = util::Instant::now();
@@ -195,15 +232,29 @@ namespace stoat::datagen {
                     gamesPerSec,
                     posPerSec
                 );
+
+                if (mateProbeNodes > 0) {
+                    fmt::println("thread {}: {} games adjudicated by the mate solver", id, adjudicatedGames);
+                }
             };
 
             while (!s_stop.load()) {
                 searcher.newGame();
 
-                format.startStandard();
-                keyHistory.clear();
+                auto startpos = getStartpos(rng, keyHistory, format, book);
+
+                if (!startpos) {
+                    const std::scoped_lock lock{s_printMutex};
+                    fmt::println(
+                        stderr,
+                        "thread {}: failed to find a valid position in the opening book, stopping",
+                        id
+                    );
+                    s_bookExhausted.store(true);
+                    break;
+                }
 
-                auto pos = getStartpos(rng, keyHistory, format);
+                auto pos = *startpos;
                 thread.nnueState.reset(pos);
 
                 u32 winPlies{};
@@ -211,11 +262,22 @@ namespace stoat::datagen {
                 u32 drawPlies{};
 
                 std::optional<format::Outcome> outcome{};
+                GameEnd end{};
 
                 while (!outcome) {
+                    if (mateProbeNodes > 0 && mateSolver.solve(pos, keyHistory, mateProbeNodes)) {
+                        outcome =
+                            pos.stm() == Colors::kBlack ? format::Outcome::kBlackWin : format::Outcome::kBlackLoss;
+                        end = GameEnd::kMateSolver;
+                        ++adjudicatedGames;
+                        break;
+                    }
+
                     thread.reset(pos, keyHistory);
                     searcher.runDatagenSearch();
 
+                    counters.addNodes(thread.loadNodes());
+
                     const auto& rootMove = thread.pvMove();
 
                     const auto blackScore = pos.stm() == Colors::kBlack ? rootMove.score : -rootMove.score;
@@ -224,24 +286,30 @@ namespace stoat::datagen {
                     if (move.isNull()) {
                         outcome =
                             pos.stm() == Colors::kBlack ? format::Outcome::kBlackLoss : format::Outcome::kBlackWin;
+                        end = GameEnd::kNoLegalMoves;
                         break;
                     }
 
                     if (std::abs(blackScore) > kScoreWin) {
                         outcome = blackScore > 0 ? format::Outcome::kBlackWin : format::Outcome::kBlackLoss;
+                        end = GameEnd::kMateScore;
                         break;
                     }
 
                     const auto oldPos = pos;
 
                     keyHistory.push_back(pos.key());
-                    pos = pos.applyMove(move);
-                    thread.nnueState.reset(pos);
+
+                    // carry the root accumulator forward rather than refreshing it
+                    eval::nnue::UpdateContext nnueCtx{};
+                    pos = pos.applyMove(move, eval::nnue::BoardObserver{nnueCtx});
+                    thread.nnueState.applyImmediately(nnueCtx, pos);
 
                     const auto sennichite = pos.testSennichite(false, keyHistory, 999999999);
 
                     if (sennichite == SennichiteStatus::kDraw) {
                         outcome = format::Outcome::kDraw;
+                        end = GameEnd::kRepetition;
                         break;
                     } else if (sennichite == SennichiteStatus::kWin) {
                         const std::scoped_lock lock{s_printMutex};
@@ -262,6 +330,7 @@ namespace stoat::datagen {
                         errStream.flush();
 
                         outcome = format::Outcome::kDraw;
+                        end = GameEnd::kIllegalPerpetual;
                         break;
                     }
 
@@ -270,6 +339,7 @@ namespace stoat::datagen {
                     if (pos.isEnteringKingsWin()) {
                         outcome =
                             pos.stm() == Colors::kBlack ? format::Outcome::kBlackWin : format::Outcome::kBlackLoss;
+                        end = GameEnd::kEnteringKings;
                         break;
                     }
 
@@ -293,10 +363,13 @@ namespace stoat::datagen {
 
                     if (winPlies >= 6) {
                         outcome = format::Outcome::kBlackWin;
+                        end = GameEnd::kWinAdjudication;
                     } else if (lossPlies >= 6) {
                         outcome = format::Outcome::kBlackLoss;
+                        end = GameEnd::kWinAdjudication;
                     } else if (drawPlies >= 10) {
                         outcome = format::Outcome::kDraw;
+                        end = GameEnd::kDrawAdjudication;
                     }
 
                     format.push(move, blackScore);
@@ -304,28 +377,40 @@ namespace stoat::datagen {
 
                 assert(outcome);
 
-                totalPositions += format.writeAllWithOutcome(stream, *outcome);
-                stream.flush();
+                const auto positions = format.writeAllWithOutcome(buffer.stream(), *outcome);
+
+                totalPositions += positions;
+                counters.addGame(positions, *outcome, end);
 
                 ++gameCount;
+                ++totalGames;
+
+                buffer.commit({
+                    .seed = checkpoint.seed,
+                    .rngState = rng.state(),
+                    .games = totalGames,
+                    .options = checkpoint.options,
+                });
 
                 if ((gameCount % kReportInterval) == 0) {
                     printProgress();
                 }
             }
 
+            buffer.submit();
+
             if ((gameCount % kReportInterval) != 0) {
                 printProgress();
             }
         }
     } // namespace
 
-    i32 run(std::string_view output, u32 threadCount) {
+    i32 run(const DatagenOptions& options) {
         if (!util::signal::setCtrlCHandler([] { s_stop.store(true); })) {
             return 1;
         }
 
-        const auto outDir = std::filesystem::path{output};
+        const auto outDir = std::filesystem::path{options.output};
 
         if (!std::filesystem::exists(outDir)) {
             std::filesystem::create_directories(outDir);
@@ -336,29 +421,180 @@ namespace stoat::datagen {
             return 1;
         }
 
-        const auto baseSeed = util::rng::generateSingleSeed();
+        std::optional<OpeningBook> book{};
+
+        if (options.bookFile) {
+            if (!book.emplace().open(*options.bookFile)) {
+                return 1;
+            }
+        }
+
+        const auto threadCount = options.threads;
+
+        // everything besides the seed that changes the games generated
+        const auto checkpointOptions = fmt::format(
+            "threads {} format {} mateprobe {} nodes {} {} randommoves {} {} {} book {}",
+            threadCount,
+            format::fileExtension(options.format),
+            options.mateProbeNodes,
+            kSoftNodes,
+            kHardNodes,
+            kBaseRandomMoves,
+            kBookRandomMoves,
+            kRandomizeStartSide,
+            options.bookFile ? std::filesystem::absolute(*options.bookFile).string() : "none"
+        );
+
+        auto seed = options.seed;
+
+        // checkpoints for threads that this run would not resume
+        for (const auto& entry : std::filesystem::directory_iterator{outDir}) {
+            const auto& path = entry.path();
+
+            if (path.extension() != ".ckpt") {
+                continue;
+            }
+
+            if (u32 id{}; util::tryParse(id, path.stem().string()) && id >= threadCount) {
+                fmt::println(
+                    stderr,
+                    "checkpoint \"{}\" is for a thread beyond the {} requested, use the same thread count",
+                    path,
+                    threadCount
+                );
+                return 1;
+            }
+        }
+
+        std::vector<std::optional<Checkpoint>> checkpoints(threadCount);
+
+        for (u32 id = 0; id < threadCount; ++id) {
+            const auto checkpointPath = outDir / fmt::format("{}.ckpt", id);
+            const auto outPath = outDir / fmt::format("{}.{}", id, format::fileExtension(options.format));
+
+            if (!std::filesystem::exists(checkpointPath)) {
+                std::error_code error{};
+                const auto size = std::filesystem::file_size(outPath, error);
+
+                if (options.resume && !error && size > 0) {
+                    fmt::println(stderr, "no checkpoint to resume \"{}\" from", outPath);
+                    return 1;
+                }
+
+                continue;
+            }
+
+            if (!options.resume) {
+                fmt::println(stderr, "output directory already holds checkpoints, resume the run instead");
+                return 1;
+            }
+
+            auto& checkpoint = checkpoints[id];
+            checkpoint = Checkpoint::load(checkpointPath);
+
+            if (!checkpoint) {
+                return 1;
+            }
+
+            if (seed && *seed != checkpoint->seed) {
+                fmt::println(stderr, "checkpoint \"{}\" is from a run with a different seed", checkpointPath);
+                return 1;
+            }
+
+            if (checkpoint->options != checkpointOptions) {
+                fmt::println(stderr, "checkpoint \"{}\" is from a run with different options", checkpointPath);
+                fmt::println(stderr, "checkpoint: {}", checkpoint->options);
+                fmt::println(stderr, "current:    {}", checkpointOptions);
+                return 1;
+            }
+
+            seed = checkpoint->seed;
+
+            std::error_code error{};
+            const auto size = std::filesystem::file_size(outPath, error);
+
+            if (error || size < checkpoint->bytes) {
+                fmt::println(stderr, "output file \"{}\" is missing data up to its checkpoint", outPath);
+                return 1;
+            }
+
+            // games after the checkpoint, complete or not, are generated again identically
+            if (size > checkpoint->bytes) {
+                std::filesystem::resize_file(outPath, checkpoint->bytes, error);
+
+                if (error) {
+                    fmt::println(stderr, "failed to truncate \"{}\": {}", outPath, error.message());
+                    return 1;
+                }
+
+                fmt::println("thread {}: discarded {} bytes after the last checkpoint", id, size - checkpoint->bytes);
+            }
+
+            fmt::println("thread {}: resuming after {} games", id, checkpoint->games);
+        }
+
+        const auto baseSeed = seed ? *seed : util::rng::generateSingleSeed();
         fmt::println("Base seed: {}", baseSeed);
 
         util::rng::SeedGenerator seedGenerator{baseSeed};
 
+        AsyncWriter writer{threadCount};
+
+        if (!writer.start(outDir, format::fileExtension(options.format))) {
+            return 1;
+        }
+
+        Telemetry telemetry{threadCount};
+
+        if (!telemetry.start(outDir / "telemetry.jsonl", kTelemetryInterval)) {
+            return 1;
+        }
+
         fmt::println("Starting {} threads", threadCount);
 
         std::vector<std::thread> threads{};
         threads.reserve(threadCount);
 
         for (u32 id = 0; id < threadCount; ++id) {
-            const auto seed = seedGenerator.nextSeed();
-            threads.emplace_back([&, id, seed] { runThread(id, seed, outDir); });
+            // thread seeds only depend on the base seed and the thread's id
+            const auto threadSeed = seedGenerator.nextSeed();
+
+            const auto start = checkpoints[id].value_or(Checkpoint{
+                .seed = baseSeed,
+                .rngState = util::rng::Jsf64Rng{threadSeed}.state(),
+                .options = checkpointOptions,
+            });
+
+            threads.emplace_back([&, id, start] {
+                runThread(
+                    id,
+                    start,
+                    outDir,
+                    writer,
+                    book ? &*book : nullptr,
+                    options.mateProbeNodes,
+                    options.format,
+                    telemetry.counters(id)
+                );
+            });
         }
 
         for (auto& thread : threads) {
             thread.join();
         }
 
+        writer.finish();
+        telemetry.stop();
+
         if (s_errOut) {
             s_errOut = {};
         }
 
+        if (s_bookExhausted.load()) {
+            fmt::println(stderr, "datagen ended early - the opening book holds too few valid positions");
+            return 1;
+        }
+
         fmt::println("done");
 
         return 0;
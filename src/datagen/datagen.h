@@ -20,8 +20,27 @@
 
 #include "../types.h"
 
-#include <string_view>
+#include <optional>
+#include <string>
+
+#include "format/games.h"
 
 namespace stoat::datagen {
-    i32 run(std::string_view output, u32 threadCount);
-}
+    struct DatagenOptions {
+        std::string output{};
+        u32 threads{1};
+        format::GameFormat format{format::GameFormat::kStoatpack};
+        // one position per line, sampled for each game instead of playing random moves from startpos
+        std::optional<std::string> bookFile{};
+        // node budget for a proof-number mate search before every move, ending the game
+        // early once a forced mate is found. 0 disables it
+        u32 mateProbeNodes{};
+        // generated if not given. Runs with the same seed, thread count and
+        // other options produce the same games
+        std::optional<u64> seed{};
+        // continue from the checkpoints in the output directory, discarding anything written after them
+        bool resume{};
+    };
+
+    i32 run(const DatagenOptions& options);
+} // namespace stoat::datagen
@@ -0,0 +1,292 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "deltapack.h"
+
+#include <algorithm>
+
+namespace stoat::datagen::format {
+    namespace {
+        constexpr u8 kStandardType = 0;
+        // followed by the start position as a Stoatformat record
+        constexpr u8 kArbitraryPositionType = 1;
+
+        constexpr u8 kTypeMask = 0x3F;
+        constexpr i32 kOutcomeShift = 6;
+
+        constexpr u32 kVarintMaxBytes = 5;
+
+        // Moves are coded by their rank among the position's legal moves, ordered by raw value,
+        // so neither the set of moves nor their order depends on how movegen works
+        void generateLegalMoves(movegen::MoveList& dst, const Position& pos) {
+            dst.clear();
+            movegen::generateLegal<true>(dst, pos);
+        }
+
+        void writeVarint(std::vector<u8>& dst, u32 value) {
+            while (value >= 0x80) {
+                dst.push_back(static_cast<u8>(value | 0x80));
+                value >>= 7;
+            }
+
+            dst.push_back(static_cast<u8>(value));
+        }
+
+        [[nodiscard]] constexpr u32 zigzagEncode(i32 value) {
+            return (static_cast<u32>(value) << 1) ^ static_cast<u32>(value >> 31);
+        }
+
+        [[nodiscard]] constexpr i32 zigzagDecode(u32 value) {
+            return static_cast<i32>(value >> 1) ^ -static_cast<i32>(value & 1);
+        }
+
+        static_assert(zigzagDecode(zigzagEncode(-kScoreInf)) == -kScoreInf);
+        static_assert(zigzagDecode(zigzagEncode(kScoreInf)) == kScoreInf);
+    } // namespace
+
+    Deltapack::Deltapack() {
+        m_unscoredMoves.reserve(32);
+        m_moves.reserve(1024);
+    }
+
+    void Deltapack::startStandard() {
+        m_pos = Position::startpos();
+        m_startpos = {};
+        reset();
+    }
+
+    void Deltapack::startFromPosition(const Position& pos) {
+        m_pos = pos;
+        // outcome is filled in once known
+        m_startpos = StoatformatRecord::pack(pos, 0, Outcome::kDraw);
+        reset();
+    }
+
+    void Deltapack::pushUnscored(Move move) {
+        assert(m_scoredCount == 0);
+
+        encodeMove(m_unscoredMoves, move);
+        ++m_unscoredCount;
+    }
+
+    void Deltapack::push(Move move, Score score) {
+        assert(std::abs(score) <= kScoreInf);
+
+        encodeMove(m_moves, move);
+
+        writeVarint(m_moves, zigzagEncode(score - m_lastScore));
+        m_lastScore = score;
+
+        ++m_scoredCount;
+    }
+
+    usize Deltapack::writeAllWithOutcome(std::ostream& stream, Outcome outcome) {
+        const auto type = m_startpos ? kArbitraryPositionType : kStandardType;
+
+        const u8 wdlType = type | (static_cast<u8>(outcome) << kOutcomeShift);
+        stream.write(reinterpret_cast<const char*>(&wdlType), sizeof(wdlType));
+
+        if (m_startpos) {
+            m_startpos->setWdl(outcome);
+            stream.write(reinterpret_cast<const char*>(&*m_startpos), sizeof(StoatformatRecord));
+        }
+
+        std::vector<u8> count{};
+
+        writeVarint(count, m_unscoredCount);
+        stream.write(reinterpret_cast<const char*>(count.data()), static_cast<std::streamsize>(count.size()));
+        stream.write(
+            reinterpret_cast<const char*>(m_unscoredMoves.data()),
+            static_cast<std::streamsize>(m_unscoredMoves.size())
+        );
+
+        count.clear();
+
+        writeVarint(count, m_scoredCount);
+        stream.write(reinterpret_cast<const char*>(count.data()), static_cast<std::streamsize>(count.size()));
+        stream.write(reinterpret_cast<const char*>(m_moves.data()), static_cast<std::streamsize>(m_moves.size()));
+
+        return m_scoredCount;
+    }
+
+    void Deltapack::reset() {
+        m_unscoredCount = 0;
+        m_scoredCount = 0;
+
+        m_lastScore = 0;
+
+        m_unscoredMoves.clear();
+        m_moves.clear();
+    }
+
+    void Deltapack::encodeMove(std::vector<u8>& dst, Move move) {
+        generateLegalMoves(m_legalMoves, m_pos);
+
+        assert(std::ranges::find(m_legalMoves, move) != m_legalMoves.end());
+
+        const auto rank = std::ranges::count_if(m_legalMoves, [&](Move legalMove) {
+            return legalMove.raw() < move.raw();
+        });
+
+        writeVarint(dst, static_cast<u32>(rank));
+
+        m_pos = m_pos.applyMove(move);
+    }
+
+    DeltapackReader::DeltapackReader(std::istream& stream) :
+            m_stream{stream} {}
+
+    ReadResult DeltapackReader::next(StoatpackGame& game) {
+        game.startpos = {};
+        game.unscoredMoves.clear();
+        game.moves.clear();
+
+        m_gameBytes = 0;
+
+        u8 wdlType{};
+
+        if (!m_stream.read(reinterpret_cast<char*>(&wdlType), sizeof(wdlType))) {
+            return ReadResult::kEnd;
+        }
+
+        m_gameBytes += sizeof(wdlType);
+
+        const auto type = wdlType & kTypeMask;
+        const auto outcome = wdlType >> kOutcomeShift;
+
+        if ((type != kStandardType && type != kArbitraryPositionType) || outcome > static_cast<u8>(Outcome::kBlackWin)) {
+            return ReadResult::kInvalid;
+        }
+
+        game.outcome = static_cast<Outcome>(outcome);
+
+        if (type == kArbitraryPositionType) {
+            auto& record = game.startpos.emplace();
+
+            if (!m_stream.read(reinterpret_cast<char*>(&record), sizeof(StoatformatRecord))) {
+                return ReadResult::kTruncated;
+            }
+
+            m_gameBytes += sizeof(StoatformatRecord);
+        }
+
+        auto startpos = game.startPosition();
+
+        if (!startpos) {
+            return ReadResult::kInvalid;
+        }
+
+        auto pos = *startpos;
+
+        u32 unscoredCount{};
+
+        if (const auto result = readVarint(unscoredCount); result != ReadResult::kOk) {
+            return result;
+        }
+
+        for (u32 i = 0; i < unscoredCount; ++i) {
+            Move move{};
+
+            if (const auto result = readMove(pos, move); result != ReadResult::kOk) {
+                return result;
+            }
+
+            game.unscoredMoves.push_back(move);
+        }
+
+        u32 scoredCount{};
+
+        if (const auto result = readVarint(scoredCount); result != ReadResult::kOk) {
+            return result;
+        }
+
+        i32 lastScore{};
+
+        for (u32 i = 0; i < scoredCount; ++i) {
+            Move move{};
+
+            if (const auto result = readMove(pos, move); result != ReadResult::kOk) {
+                return result;
+            }
+
+            u32 delta{};
+
+            if (const auto result = readVarint(delta); result != ReadResult::kOk) {
+                return result;
+            }
+
+            const auto score = lastScore + zigzagDecode(delta);
+
+            if (std::abs(score) > kScoreInf) {
+                return ReadResult::kInvalid;
+            }
+
+            game.moves.emplace_back(move, score);
+            lastScore = score;
+        }
+
+        m_validBytes += m_gameBytes;
+
+        return ReadResult::kOk;
+    }
+
+    ReadResult DeltapackReader::readVarint(u32& dst) {
+        dst = 0;
+
+        for (u32 i = 0; i < kVarintMaxBytes; ++i) {
+            const auto byte = m_stream.get();
+
+            if (byte == std::istream::traits_type::eof()) {
+                return ReadResult::kTruncated;
+            }
+
+            ++m_gameBytes;
+
+            dst |= static_cast<u32>(byte & 0x7F) << (7 * i);
+
+            if ((byte & 0x80) == 0) {
+                return ReadResult::kOk;
+            }
+        }
+
+        return ReadResult::kInvalid;
+    }
+
+    ReadResult DeltapackReader::readMove(Position& pos, Move& dst) {
+        u32 rank{};
+
+        if (const auto result = readVarint(rank); result != ReadResult::kOk) {
+            return result;
+        }
+
+        generateLegalMoves(m_legalMoves, pos);
+
+        if (rank >= m_legalMoves.size()) {
+            return ReadResult::kInvalid;
+        }
+
+        // cheaper than sorting every move list
+        const auto itr = m_legalMoves.begin() + rank;
+        std::ranges::nth_element(m_legalMoves, itr, {}, [](Move move) { return move.raw(); });
+
+        dst = *itr;
+        pos = pos.applyMove(dst);
+
+        return ReadResult::kOk;
+    }
+} // namespace stoat::datagen::format
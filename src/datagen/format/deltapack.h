@@ -0,0 +1,98 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../../types.h"
+
+#include <istream>
+#include <optional>
+#include <vector>
+
+#include "../../movegen.h"
+#include "format.h"
+#include "stoatformat.h"
+#include "stoatpack.h"
+
+namespace stoat::datagen::format {
+    // Compact alternative to Stoatpack. Each move is stored as its rank among the position's
+    // legal moves by raw value, so the coding does not depend on movegen, and each score as
+    // the zigzag-coded difference from the previous one. Both are LEB128 varints, so moves
+    // take one or two bytes and most scores one or two.
+    //
+    // A game is a type/outcome byte as in Stoatpack, the start position as a Stoatformat record
+    // if it is not the standard one, the unscored move count and moves, then the scored move
+    // count followed by (move, score) pairs. Scores are from black's perspective
+    class Deltapack final : public IDataFormat {
+    public:
+        Deltapack();
+        ~Deltapack() final = default;
+
+        void startStandard() final;
+        void startFromPosition(const Position& pos) final;
+
+        void pushUnscored(Move move) final;
+        void push(Move move, Score score) final;
+
+        usize writeAllWithOutcome(std::ostream& stream, Outcome outcome) final;
+
+    private:
+        // the position the next move is played from
+        Position m_pos{};
+        movegen::MoveList m_legalMoves{};
+
+        std::optional<StoatformatRecord> m_startpos{};
+
+        u32 m_unscoredCount{};
+        u32 m_scoredCount{};
+
+        i32 m_lastScore{};
+
+        std::vector<u8> m_unscoredMoves{};
+        std::vector<u8> m_moves{};
+
+        void reset();
+        void encodeMove(std::vector<u8>& dst, Move move);
+    };
+
+    // Reads back games written by Deltapack. Decoding moves requires replaying
+    // them, so unlike Stoatpack every move read is known to be legal
+    class DeltapackReader final : public IGameReader {
+    public:
+        explicit DeltapackReader(std::istream& stream);
+        ~DeltapackReader() final = default;
+
+        [[nodiscard]] ReadResult next(StoatpackGame& game) final;
+
+        [[nodiscard]] inline u64 validBytes() const final {
+            return m_validBytes;
+        }
+
+    private:
+        std::istream& m_stream;
+        u64 m_validBytes{};
+
+        // bytes read from the current game so far
+        u64 m_gameBytes{};
+
+        movegen::MoveList m_legalMoves{};
+
+        [[nodiscard]] ReadResult readVarint(u32& dst);
+        [[nodiscard]] ReadResult readMove(Position& pos, Move& dst);
+    };
+} // namespace stoat::datagen::format
@@ -38,7 +38,9 @@ namespace stoat::datagen::format {
         virtual ~IDataFormat() = default;
 
         virtual void startStandard() = 0;
-        //TODO shogi960, arbitrary position
+        // Starts a game from a position other than the standard startpos, e.g. from an opening book
+        virtual void startFromPosition(const Position& pos) = 0;
+        //TODO shogi960
 
         virtual void pushUnscored(Move move) = 0;
         virtual void push(Move move, Score score) = 0;
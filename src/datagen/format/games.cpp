@@ -0,0 +1,59 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "games.h"
+
+#include "deltapack.h"
+
+namespace stoat::datagen::format {
+    std::string_view fileExtension(GameFormat format) {
+        return format == GameFormat::kDeltapack ? "dpk" : "spk";
+    }
+
+    std::optional<GameFormat> gameFormatFromPath(const std::filesystem::path& path) {
+        const auto extension = path.extension();
+
+        if (extension == ".spk") {
+            return GameFormat::kStoatpack;
+        } else if (extension == ".dpk") {
+            return GameFormat::kDeltapack;
+        }
+
+        return {};
+    }
+
+    std::unique_ptr<IDataFormat> createWriter(GameFormat format) {
+        if (format == GameFormat::kDeltapack) {
+            return std::make_unique<Deltapack>();
+        }
+
+        return std::make_unique<Stoatpack>();
+    }
+
+    std::unique_ptr<IGameReader> createReader(GameFormat format, std::istream& stream) {
+        if (format == GameFormat::kDeltapack) {
+            return std::make_unique<DeltapackReader>(stream);
+        }
+
+        return std::make_unique<StoatpackReader>(stream);
+    }
+
+    std::unique_ptr<IGameReader> createReader(const std::filesystem::path& path, std::istream& stream) {
+        return createReader(gameFormatFromPath(path).value_or(GameFormat::kStoatpack), stream);
+    }
+} // namespace stoat::datagen::format
@@ -0,0 +1,49 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../../types.h"
+
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "format.h"
+#include "stoatpack.h"
+
+namespace stoat::datagen::format {
+    // Formats storing whole games, that can all be read back as StoatpackGames
+    enum class GameFormat {
+        kStoatpack = 0,
+        kDeltapack,
+    };
+
+    [[nodiscard]] std::string_view fileExtension(GameFormat format);
+
+    // Returns nothing if the path does not end in .spk or .dpk
+    [[nodiscard]] std::optional<GameFormat> gameFormatFromPath(const std::filesystem::path& path);
+
+    [[nodiscard]] std::unique_ptr<IDataFormat> createWriter(GameFormat format);
+    [[nodiscard]] std::unique_ptr<IGameReader> createReader(GameFormat format, std::istream& stream);
+
+    // Picks the reader by extension, treating anything not recognised as Stoatpack
+    [[nodiscard]] std::unique_ptr<IGameReader> createReader(const std::filesystem::path& path, std::istream& stream);
+} // namespace stoat::datagen::format
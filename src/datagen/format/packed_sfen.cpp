@@ -0,0 +1,132 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "packed_sfen.h"
+
+namespace stoat::datagen::format {
+    namespace {
+        constexpr u16 kMoveDropFlag = 1 << 14;
+        constexpr u16 kMovePromoFlag = 1 << 15;
+
+        // destination in the low 7 bits, then the origin, or the dropped piece type counting from 1
+        [[nodiscard]] u16 packMove(Move move) {
+            auto packed = static_cast<u16>(PackedSfen::squareIdx(move.to()));
+
+            if (move.isDrop()) {
+                packed |= static_cast<u16>(move.dropPiece().raw() + 1) << 7;
+                packed |= kMoveDropFlag;
+            } else {
+                packed |= static_cast<u16>(PackedSfen::squareIdx(move.from())) << 7;
+
+                if (move.isPromo()) {
+                    packed |= kMovePromoFlag;
+                }
+            }
+
+            return packed;
+        }
+
+        [[nodiscard]] Square unpackSquare(u32 idx) {
+            return Square::fromFileRank(8 - static_cast<i32>(idx / 9), 8 - static_cast<i32>(idx % 9));
+        }
+    } // namespace
+
+    std::optional<Position> PackedSfenValue::unpack() const {
+        auto pos = Position::fromPackedSfen(sfen, gamePly);
+
+        if (!pos) {
+            return {};
+        }
+
+        return pos.take();
+    }
+
+    std::optional<Move> PackedSfenValue::unpackMove(const Position& pos) const {
+        const auto toIdx = move & 0x7f;
+        const auto fromIdx = (move >> 7) & 0x7f;
+
+        if (toIdx >= Squares::kCount) {
+            return {};
+        }
+
+        const auto to = unpackSquare(toIdx);
+
+        Move unpacked;
+
+        if ((move & kMoveDropFlag) != 0) {
+            // pawn to gold, counting from 1
+            if (fromIdx < 1 || fromIdx > PieceTypes::kGold.raw() + 1 || (move & kMovePromoFlag) != 0) {
+                return {};
+            }
+
+            unpacked = Move::makeDrop(PieceType::fromRaw(static_cast<u8>(fromIdx - 1)), to);
+        } else {
+            if (fromIdx >= Squares::kCount) {
+                return {};
+            }
+
+            const auto from = unpackSquare(fromIdx);
+
+            unpacked = (move & kMovePromoFlag) != 0 ? Move::makePromotion(from, to) : Move::makeNormal(from, to);
+        }
+
+        if (!pos.isPseudolegal(unpacked) || !pos.isLegal(unpacked)) {
+            return {};
+        }
+
+        return unpacked;
+    }
+
+    i16 PackedSfenValue::senteScore(Color stm) const {
+        return stm == Colors::kBlack ? score : static_cast<i16>(-score);
+    }
+
+    std::optional<Outcome> PackedSfenValue::outcome(Color stm) const {
+        if (gameResult == 0) {
+            return Outcome::kDraw;
+        }
+
+        if (gameResult != 1 && gameResult != -1) {
+            return {};
+        }
+
+        return (gameResult == 1) == (stm == Colors::kBlack) ? Outcome::kBlackWin : Outcome::kBlackLoss;
+    }
+
+    std::optional<PackedSfenValue> PackedSfenValue::pack(const Position& pos, Move move, i16 senteScore, Outcome wdl) {
+        const auto sfen = pos.packSfen();
+
+        if (!sfen) {
+            return {};
+        }
+
+        PackedSfenValue value{};
+
+        value.sfen = *sfen;
+        value.score = pos.stm() == Colors::kBlack ? senteScore : static_cast<i16>(-senteScore);
+        value.move = packMove(move);
+        value.gamePly = pos.moveCount();
+
+        if (wdl != Outcome::kDraw) {
+            const bool blackWin = wdl == Outcome::kBlackWin;
+            value.gameResult = blackWin == (pos.stm() == Colors::kBlack) ? 1 : -1;
+        }
+
+        return value;
+    }
+} // namespace stoat::datagen::format
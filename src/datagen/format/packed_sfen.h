@@ -0,0 +1,61 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../../types.h"
+
+#include <optional>
+
+#include "format.h"
+
+namespace stoat::datagen::format {
+    // YaneuraOu's PackedSfenValue, the record format read by most shogi NNUE trainers
+    struct PackedSfenValue {
+        PackedSfen sfen{};
+        // from the side to move's perspective
+        i16 score{};
+        // YaneuraOu's 16-bit move encoding
+        u16 move{};
+        u16 gamePly{};
+        // 1 if the side to move won, -1 if it lost, 0 for a draw
+        i8 gameResult{};
+        [[maybe_unused]] u8 _padding{};
+
+        // Returns nothing if the record does not hold a valid position
+        [[nodiscard]] std::optional<Position> unpack() const;
+
+        // Returns nothing if the move is not legal in pos, the unpacked position
+        [[nodiscard]] std::optional<Move> unpackMove(const Position& pos) const;
+
+        // Score and game result from black's perspective, given the side to move of the unpacked
+        // position. The result is nothing if gameResult is not one of -1, 0 or 1
+        [[nodiscard]] i16 senteScore(Color stm) const;
+        [[nodiscard]] std::optional<Outcome> outcome(Color stm) const;
+
+        // Returns nothing if pieces are missing from the position, as in handicap games
+        [[nodiscard]] static std::optional<PackedSfenValue> pack(
+            const Position& pos,
+            Move move,
+            i16 senteScore,
+            Outcome wdl
+        );
+    };
+
+    static_assert(sizeof(PackedSfenValue) == 40);
+} // namespace stoat::datagen::format
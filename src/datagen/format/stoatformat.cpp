@@ -18,6 +18,8 @@
 
 #include "stoatformat.h"
 
+#include <string>
+
 namespace stoat::datagen::format {
     Color StoatformatRecord::stm() const {
         const auto stm = static_cast<u8>(occ[0] >> 90) & 0x1;
@@ -40,6 +42,88 @@ namespace stoat::datagen::format {
         occ[0] = (occ[0] & ~kWdlMask) | (static_cast<u128>(wdl) << 88);
     }
 
+    std::optional<Position> StoatformatRecord::unpack() const {
+        static constexpr u128 kOccMask = (u128{1} << Squares::kCount) - 1;
+        static constexpr usize kMaxPieces = 40;
+
+        std::array<Piece, Squares::kCount> mailbox{};
+        mailbox.fill(Pieces::kNone);
+
+        usize pieceIdx = 0;
+
+        for (const auto c : {Colors::kBlack, Colors::kWhite}) {
+            auto bb = Bitboard{occ[c.idx()] & kOccMask};
+            while (!bb.empty()) {
+                const auto sq = bb.popLsb();
+
+                if (pieceIdx >= kMaxPieces || mailbox[sq.idx()] != Pieces::kNone) {
+                    return {};
+                }
+
+                const auto pt = pieces[pieceIdx++];
+
+                if (pt >= PieceTypes::kCount) {
+                    return {};
+                }
+
+                mailbox[sq.idx()] = PieceType::fromRaw(pt).withColor(c);
+            }
+        }
+
+        // go through an sfen, rather than duplicating all of its validation
+        std::string sfen{};
+        auto itr = std::back_inserter(sfen);
+
+        for (i32 rank = 8; rank >= 0; --rank) {
+            u32 emptySquares = 0;
+
+            for (i32 file = 0; file < 9; ++file) {
+                const auto piece = mailbox[Square::fromFileRank(file, rank).idx()];
+
+                if (piece == Pieces::kNone) {
+                    ++emptySquares;
+                    continue;
+                }
+
+                if (emptySquares > 0) {
+                    fmt::format_to(itr, "{}", emptySquares);
+                    emptySquares = 0;
+                }
+
+                fmt::format_to(itr, "{}", piece);
+            }
+
+            if (emptySquares > 0) {
+                fmt::format_to(itr, "{}", emptySquares);
+            }
+
+            if (rank > 0) {
+                fmt::format_to(itr, "/");
+            }
+        }
+
+        const auto blackHand = Hand::fromRaw(static_cast<u32>(occ[0] >> 96));
+        const auto whiteHand = Hand::fromRaw(static_cast<u32>(occ[1] >> 96));
+
+        fmt::format_to(itr, "{}", stm() == Colors::kBlack ? " b " : " w ");
+
+        if (blackHand.empty() && whiteHand.empty()) {
+            fmt::format_to(itr, "-");
+        } else {
+            fmt::format_to(itr, "{}{}", blackHand.sfen(true), whiteHand.sfen(false));
+        }
+
+        fmt::format_to(itr, " {}", plyCount);
+
+        auto pos = Position::fromSfen(sfen);
+
+        if (!pos) {
+            return {};
+        }
+
+        return pos.take();
+    }
+
     StoatformatRecord StoatformatRecord::pack(const Position& pos, i16 senteScore, Outcome wdl) {
         StoatformatRecord record{};
 
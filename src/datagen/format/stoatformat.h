@@ -21,6 +21,7 @@
 #include "../../types.h"
 
 #include <array>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -41,6 +42,9 @@ namespace stoat::datagen::format {
         [[nodiscard]] Outcome wdl() const;
         void setWdl(Outcome wdl);
 
+        // Returns nothing if the record does not hold a valid position
+        [[nodiscard]] std::optional<Position> unpack() const;
+
         [[nodiscard]] static StoatformatRecord pack(const Position& pos, i16 senteScore, Outcome wdl);
     };
 
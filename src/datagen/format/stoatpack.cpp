@@ -22,16 +22,75 @@
 
 namespace stoat::datagen::format {
     namespace {
+        constexpr u8 kStandardType = 0;
+        // followed by the start position as a Stoatformat record
+        constexpr u8 kArbitraryPositionType = 1;
+
+        constexpr u8 kTypeMask = 0x3F;
+        constexpr i32 kOutcomeShift = 6;
+
+        // new: P, L, N, S, B, R, G, K, +P, +L, +N, +S, +B, +R
+        // old: P, +P, L, N, +L, +N, S, +S, G, B, R, +B, +R, K
+        constexpr std::array<u16, PieceTypes::kCount> kPieceTypeMap{0, 2, 3, 6, 9, 10, 8, 13, 1, 4, 5, 7, 11, 12};
+
+        constexpr auto kInversePieceTypeMap = [] {
+            std::array<u8, PieceTypes::kCount> map{};
+
+            for (usize pt = 0; pt < PieceTypes::kCount; ++pt) {
+                map[kPieceTypeMap[pt]] = pt;
+            }
+
+            return map;
+        }();
+
+        // old drop moves store the (old) piece type in 4 bits, so
+        // they cannot be built through Move::makeDrop's 3-bit field
+        constexpr u16 kDropFlag = 1 << 15;
+        constexpr i32 kFromShift = 7;
+        constexpr i32 kOldDropPieceShift = 7;
+        constexpr u16 kOldDropPieceMask = 0xF;
+        constexpr u16 kSquareMask = 0x7F;
+
         [[nodiscard]] Move convertToOldFormat(Move move) {
             if (!move.isDrop()) {
                 return move;
             }
 
-            // new: P, L, N, S, B, R, G, K, +P, +L, +N, +S, +B, +R
-            // old: P, +P, L, N, +L, +N, S, +S, G, B, R, +B, +R, K
-            constexpr std::array kPieceTypeMap{0, 2, 3, 6, 9, 10, 8, 13, 1, 4, 5, 7, 11, 12};
+            const auto pt = kPieceTypeMap[move.dropPiece().idx()];
+            return Move::fromRaw(static_cast<u16>(move.to().raw() | (pt << kOldDropPieceShift) | kDropFlag));
+        }
+
+        // Returns a null move if the move cannot be valid
+        [[nodiscard]] Move convertFromOldFormat(u16 raw) {
+            const auto to = raw & kSquareMask;
+
+            if (to >= Squares::kCount) {
+                return kNullMove;
+            }
+
+            if ((raw & kDropFlag) == 0) {
+                const auto from = (raw >> kFromShift) & kSquareMask;
+                return from < Squares::kCount ? Move::fromRaw(raw) : kNullMove;
+            }
+
+            const auto oldPt = (raw >> kOldDropPieceShift) & kOldDropPieceMask;
+
+            if (oldPt >= PieceTypes::kCount) {
+                return kNullMove;
+            }
+
+            const auto pt = PieceType::fromRaw(kInversePieceTypeMap[oldPt]);
+
+            if (pt.isPromoted() || pt == PieceTypes::kKing) {
+                return kNullMove;
+            }
+
+            return Move::makeDrop(pt, Square::fromRaw(to));
+        }
 
-            return Move::makeDrop(PieceType::fromRaw(kPieceTypeMap[move.dropPiece().idx()]), move.to());
+        template <typename T>
+        [[nodiscard]] bool read(std::istream& stream, T& dst) {
+            return static_cast<bool>(stream.read(reinterpret_cast<char*>(&dst), sizeof(T)));
         }
     } // namespace
 
@@ -41,6 +100,14 @@ namespace stoat::datagen::format {
     }
 
     void Stoatpack::startStandard() {
+        m_startpos = {};
+        m_unscoredMoves.clear();
+        m_moves.clear();
+    }
+
+    void Stoatpack::startFromPosition(const Position& pos) {
+        // outcome is filled in once known
+        m_startpos = StoatformatRecord::pack(pos, 0, Outcome::kDraw);
         m_unscoredMoves.clear();
         m_moves.clear();
     }
@@ -58,11 +125,16 @@ namespace stoat::datagen::format {
     usize Stoatpack::writeAllWithOutcome(std::ostream& stream, Outcome outcome) {
         static constexpr ScoredMove kNullTerminator = {0, 0};
 
-        static constexpr u8 kStandardType = 0;
+        const auto type = m_startpos ? kArbitraryPositionType : kStandardType;
 
-        const u8 wdlType = kStandardType | (static_cast<u8>(outcome) << 6);
+        const u8 wdlType = type | (static_cast<u8>(outcome) << kOutcomeShift);
         stream.write(reinterpret_cast<const char*>(&wdlType), sizeof(wdlType));
 
+        if (m_startpos) {
+            m_startpos->setWdl(outcome);
+            stream.write(reinterpret_cast<const char*>(&*m_startpos), sizeof(StoatformatRecord));
+        }
+
         const u16 unscoredCount = m_unscoredMoves.size();
         stream.write(reinterpret_cast<const char*>(&unscoredCount), sizeof(unscoredCount));
         stream.write(reinterpret_cast<const char*>(m_unscoredMoves.data()), m_unscoredMoves.size() * sizeof(u16));
@@ -72,4 +144,102 @@ namespace stoat::datagen::format {
 
         return m_moves.size();
     }
+
+    std::optional<Position> StoatpackGame::startPosition() const {
+        if (startpos) {
+            return startpos->unpack();
+        }
+
+        return Position::startpos();
+    }
+
+    StoatpackReader::StoatpackReader(std::istream& stream) :
+            m_stream{stream} {}
+
+    ReadResult StoatpackReader::next(StoatpackGame& game) {
+        game.startpos = {};
+        game.unscoredMoves.clear();
+        game.moves.clear();
+
+        u8 wdlType{};
+
+        if (!read(m_stream, wdlType)) {
+            return ReadResult::kEnd;
+        }
+
+        u64 size = sizeof(wdlType);
+
+        const auto type = wdlType & kTypeMask;
+        const auto outcome = wdlType >> kOutcomeShift;
+
+        if ((type != kStandardType && type != kArbitraryPositionType) || outcome > static_cast<u8>(Outcome::kBlackWin)) {
+            return ReadResult::kInvalid;
+        }
+
+        game.outcome = static_cast<Outcome>(outcome);
+
+        if (type == kArbitraryPositionType) {
+            auto& record = game.startpos.emplace();
+
+            if (!read(m_stream, record)) {
+                return ReadResult::kTruncated;
+            }
+
+            size += sizeof(StoatformatRecord);
+        }
+
+        u16 unscoredCount{};
+
+        if (!read(m_stream, unscoredCount)) {
+            return ReadResult::kTruncated;
+        }
+
+        size += sizeof(unscoredCount);
+
+        for (u16 i = 0; i < unscoredCount; ++i) {
+            u16 raw{};
+
+            if (!read(m_stream, raw)) {
+                return ReadResult::kTruncated;
+            }
+
+            const auto move = convertFromOldFormat(raw);
+
+            if (!move) {
+                return ReadResult::kInvalid;
+            }
+
+            game.unscoredMoves.push_back(move);
+        }
+
+        size += unscoredCount * sizeof(u16);
+
+        while (true) {
+            std::pair<u16, i16> scoredMove{};
+
+            if (!read(m_stream, scoredMove)) {
+                return ReadResult::kTruncated;
+            }
+
+            size += sizeof(scoredMove);
+
+            const auto [raw, score] = scoredMove;
+
+            if (raw == 0 && score == 0) {
+                break;
+            }
+
+            const auto move = convertFromOldFormat(raw);
+
+            if (!move || std::abs(score) > kScoreInf) {
+                return ReadResult::kInvalid;
+            }
+
+            game.moves.emplace_back(move, score);
+        }
+
+        m_validBytes += size;
+
+        return ReadResult::kOk;
+    }
 } // namespace stoat::datagen::format
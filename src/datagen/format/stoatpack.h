@@ -20,10 +20,14 @@
 
 #include "../../types.h"
 
+#include <istream>
+#include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "format.h"
+#include "stoatformat.h"
 
 namespace stoat::datagen::format {
     class Stoatpack final : public IDataFormat {
@@ -32,6 +36,7 @@ namespace stoat::datagen::format {
         ~Stoatpack() final = default;
 
         void startStandard() final;
+        void startFromPosition(const Position& pos) final;
 
         void pushUnscored(Move move) final;
         void push(Move move, Score score) final;
@@ -42,7 +47,92 @@ namespace stoat::datagen::format {
         using ScoredMove = std::pair<u16, i16>;
         static_assert(sizeof(ScoredMove) == sizeof(u16) + sizeof(i16));
 
+        // packed start position for games not starting from the standard startpos
+        std::optional<StoatformatRecord> m_startpos{};
+
         std::vector<u16> m_unscoredMoves{};
         std::vector<ScoredMove> m_moves{};
     };
+
+    struct StoatpackGame {
+        // unset for games starting from the standard startpos
+        std::optional<StoatformatRecord> startpos{};
+        Outcome outcome{};
+
+        std::vector<Move> unscoredMoves{};
+        std::vector<std::pair<Move, Score>> moves{};
+
+        // Position before the first unscored move
+        [[nodiscard]] std::optional<Position> startPosition() const;
+    };
+
+    enum class ReadResult {
+        kOk = 0,
+        kEnd,
+        // the stream ended partway through a game
+        kTruncated,
+        kInvalid,
+    };
+
+    // Reads games back one at a time, from any of the game formats
+    class IGameReader {
+    public:
+        virtual ~IGameReader() = default;
+
+        [[nodiscard]] virtual ReadResult next(StoatpackGame& game) = 0;
+
+        // Bytes taken up by the complete games read so far
+        [[nodiscard]] virtual u64 validBytes() const = 0;
+    };
+
+    // Reads back games written by Stoatpack. Moves are decoded,
+    // but not checked for legality - replay them to validate
+    class StoatpackReader final : public IGameReader {
+    public:
+        explicit StoatpackReader(std::istream& stream);
+        ~StoatpackReader() final = default;
+
+        [[nodiscard]] ReadResult next(StoatpackGame& game) final;
+
+        [[nodiscard]] inline u64 validBytes() const final {
+            return m_validBytes;
+        }
+
+    private:
+        std::istream& m_stream;
+        u64 m_validBytes{};
+    };
+
+    // Replays a game through Position, calling visitor(pos, move, score) for each scored position, where pos
+    // is the position the move is played from. Returns a description of the first problem, if the game is invalid
+    template <typename Visitor>
+    [[nodiscard]] std::optional<std::string> replay(const StoatpackGame& game, Visitor&& visitor) {
+        const auto startpos = game.startPosition();
+
+        if (!startpos) {
+            return "invalid start position";
+        }
+
+        auto pos = *startpos;
+
+        for (const auto move : game.unscoredMoves) {
+            if (!pos.isPseudolegal(move) || !pos.isLegal(move)) {
+                return fmt::format("illegal unscored move {} in {}", move, pos.sfen());
+            }
+
+            pos = pos.applyMove(move);
+        }
+
+        for (const auto& [move, score] : game.moves) {
+            if (!pos.isPseudolegal(move) || !pos.isLegal(move)) {
+                return fmt::format("illegal move {} in {}", move, pos.sfen());
+            }
+
+            visitor(std::as_const(pos), move, score);
+
+            pos = pos.applyMove(move);
+        }
+
+        return {};
+    }
 } // namespace stoat::datagen::format
@@ -0,0 +1,179 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mate_solver.h"
+
+#include <algorithm>
+
+#include "../movegen.h"
+
+namespace stoat::datagen {
+    MateSolver::MateSolver() {
+        m_pathKeys.reserve(kMaxPly + 1);
+    }
+
+    bool MateSolver::solve(const Position& pos, std::span<const u64> keyHistory, u32 maxNodes) {
+        m_nodes.clear();
+        m_nodes.emplace_back();
+
+        m_history.assign(keyHistory.begin(), keyHistory.end());
+        std::ranges::sort(m_history);
+
+        while (m_nodes[0].pn != 0 && m_nodes[0].dn != 0 && m_nodes.size() < maxNodes) {
+            // walk down to the most-proving node, replaying its moves
+            u32 nodeIdx = 0;
+            auto curr = pos;
+            bool attacker = true;
+            u32 ply = 0;
+
+            m_pathKeys.clear();
+            m_pathKeys.push_back(curr.key());
+
+            while (m_nodes[nodeIdx].expanded) {
+                const auto& node = m_nodes[nodeIdx];
+
+                auto bestIdx = node.firstChild;
+
+                for (u32 childIdx = node.firstChild + 1; childIdx < node.firstChild + node.childCount; ++childIdx) {
+                    const auto& child = m_nodes[childIdx];
+                    const auto& best = m_nodes[bestIdx];
+
+                    if (attacker ? child.pn < best.pn : child.dn < best.dn) {
+                        bestIdx = childIdx;
+                    }
+                }
+
+                curr = curr.applyMove(m_nodes[bestIdx].move);
+                m_pathKeys.push_back(curr.key());
+
+                nodeIdx = bestIdx;
+                attacker = !attacker;
+                ++ply;
+            }
+
+            expand(nodeIdx, curr, attacker, ply);
+
+            while (true) {
+                update(nodeIdx, attacker);
+
+                if (nodeIdx == 0) {
+                    break;
+                }
+
+                nodeIdx = m_nodes[nodeIdx].parent;
+                attacker = !attacker;
+            }
+        }
+
+        return m_nodes[0].pn == 0;
+    }
+
+    bool MateSolver::isRepetition(u64 key) const {
+        return std::ranges::find(m_pathKeys, key) != m_pathKeys.end() || std::ranges::binary_search(m_history, key);
+    }
+
+    void MateSolver::expand(u32 nodeIdx, const Position& pos, bool attacker, u32 ply) {
+        m_nodes[nodeIdx].expanded = true;
+
+        if (ply >= kMaxPly) {
+            m_nodes[nodeIdx].pn = kInfinity;
+            m_nodes[nodeIdx].dn = 0;
+            return;
+        }
+
+        movegen::MoveList moves{};
+
+        if (attacker) {
+            movegen::generateLegal<false>(moves, pos);
+        } else {
+            movegen::generateLegal<true>(moves, pos);
+        }
+
+        const auto firstChild = static_cast<u32>(m_nodes.size());
+
+        for (const auto move : moves) {
+            u64 key;
+
+            if (attacker) {
+                const auto newPos = pos.applyMove(move);
+
+                if (!newPos.isInCheck()) {
+                    continue;
+                }
+
+                key = newPos.key();
+            } else {
+                key = pos.keyAfter(move);
+            }
+
+            auto& child = m_nodes.emplace_back();
+
+            child.move = move;
+            child.parent = nodeIdx;
+
+            if (isRepetition(key)) {
+                child.pn = kInfinity;
+                child.dn = 0;
+                child.expanded = true;
+            }
+        }
+
+        auto& node = m_nodes[nodeIdx];
+
+        node.firstChild = firstChild;
+        node.childCount = static_cast<u32>(m_nodes.size()) - firstChild;
+
+        if (node.childCount == 0) {
+            // no checks for the attacker, or no way out of check for the defender
+            node.pn = attacker ? kInfinity : 0;
+            node.dn = attacker ? 0 : kInfinity;
+        }
+    }
+
+    void MateSolver::update(u32 nodeIdx, bool attacker) {
+        auto& node = m_nodes[nodeIdx];
+
+        if (node.childCount == 0) {
+            return;
+        }
+
+        u32 minPn = kInfinity;
+        u32 minDn = kInfinity;
+
+        u32 sumPn = 0;
+        u32 sumDn = 0;
+
+        for (u32 childIdx = node.firstChild; childIdx < node.firstChild + node.childCount; ++childIdx) {
+            const auto& child = m_nodes[childIdx];
+
+            minPn = std::min(minPn, child.pn);
+            minDn = std::min(minDn, child.dn);
+
+            sumPn = std::min(sumPn + child.pn, kInfinity);
+            sumDn = std::min(sumDn + child.dn, kInfinity);
+        }
+
+        if (attacker) {
+            node.pn = minPn;
+            node.dn = sumDn;
+        } else {
+            node.pn = sumPn;
+            node.dn = minDn;
+        }
+    }
+} // namespace stoat::datagen
@@ -0,0 +1,68 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <vector>
+
+#include "../move.h"
+#include "../position.h"
+
+namespace stoat::datagen {
+    // Bounded proof-number search for a forced mate by consecutive checks (tsume), used to
+    // adjudicate datagen games as soon as they are decided. Only ever reports mates that are
+    // actually proven - the search gives up once it runs out of nodes, treats every repetition
+    // as a failure for the side giving check, and skips unlikely non-promotions for that side
+    class MateSolver {
+    public:
+        MateSolver();
+
+        // Returns whether the side to move in pos can force mate. Searches at most maxNodes nodes,
+        // keyHistory holds the keys of the positions before pos in the game
+        [[nodiscard]] bool solve(const Position& pos, std::span<const u64> keyHistory, u32 maxNodes);
+
+    private:
+        static constexpr u32 kInfinity = 1U << 30;
+        static constexpr u32 kMaxPly = 63;
+
+        struct Node {
+            Move move{kNullMove};
+            u32 parent{};
+            u32 firstChild{};
+            u32 childCount{};
+            u32 pn{1};
+            u32 dn{1};
+            bool expanded{};
+        };
+
+        std::vector<Node> m_nodes{};
+
+        std::vector<u64> m_history{};
+        std::vector<u64> m_pathKeys{};
+
+        [[nodiscard]] bool isRepetition(u64 key) const;
+
+        // Adds the node's children, or proves/disproves it if there are none
+        void expand(u32 nodeIdx, const Position& pos, bool attacker, u32 ply);
+
+        void update(u32 nodeIdx, bool attacker);
+    };
+} // namespace stoat::datagen
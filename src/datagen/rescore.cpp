@@ -0,0 +1,468 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rescore.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fmt/std.h>
+
+#include "../eval/nnue.h"
+#include "../limit.h"
+#include "../search.h"
+#include "../util/ctrlc.h"
+#include "../util/file_sync.h"
+#include "../util/timer.h"
+#include "format/games.h"
+#include "format/stoatpack.h"
+
+namespace stoat::datagen::rescore {
+    namespace {
+        constexpr usize kHardNodes = 8388608;
+
+        // how far ahead of the oldest unwritten game the input may be read, per thread
+        constexpr u64 kWindowPerThread = 16;
+
+        constexpr u64 kReportInterval = 1024;
+
+        // ctrl+c cannot wake anything up directly, so waits are bounded by this
+        constexpr auto kStopPollInterval = std::chrono::milliseconds{100};
+
+        std::atomic_bool s_stop{false};
+
+        struct Job {
+            u64 index;
+            format::StoatpackGame game;
+        };
+
+        struct RescoredGame {
+            std::string data;
+            usize positions;
+        };
+
+        class Pipeline {
+        public:
+            explicit Pipeline(const RescoreOptions& options) :
+                    m_options{options} {}
+
+            // Returns false once there is nothing left to do
+            [[nodiscard]] bool popJob(Job& dst) {
+                std::unique_lock lock{m_mutex};
+                m_jobSignal.wait(lock, [this] { return !m_jobs.empty() || m_inputDone; });
+
+                // on ctrl+c, finish the games already being searched but do not start any more
+                if (m_jobs.empty() || s_stop.load()) {
+                    return false;
+                }
+
+                dst = std::move(m_jobs.front());
+                m_jobs.pop_front();
+
+                return true;
+            }
+
+            void pushResult(u64 index, RescoredGame result) {
+                {
+                    const std::scoped_lock lock{m_mutex};
+                    m_results.emplace(index, std::move(result));
+                }
+
+                m_resultSignal.notify_one();
+            }
+
+            void fail(std::string message) {
+                {
+                    const std::scoped_lock lock{m_mutex};
+
+                    if (!m_error) {
+                        m_error = std::move(message);
+                    }
+                }
+
+                m_resultSignal.notify_one();
+            }
+
+            [[nodiscard]] i32 run(std::istream& input, std::ostream& output, u64 skippedGames);
+
+        private:
+            const RescoreOptions& m_options;
+
+            std::mutex m_mutex{};
+            std::condition_variable m_jobSignal{};
+            std::condition_variable m_resultSignal{};
+
+            std::deque<Job> m_jobs{};
+            bool m_inputDone{};
+
+            std::map<u64, RescoredGame> m_results{};
+            u64 m_nextToWrite{};
+
+            std::optional<std::string> m_error{};
+
+            u64 m_gamesWritten{};
+            usize m_positionsWritten{};
+
+            // Writes out finished games, as long as every earlier game has also been written
+            void writeReady(std::ostream& output) {
+                while (true) {
+                    RescoredGame result{};
+
+                    {
+                        const std::scoped_lock lock{m_mutex};
+
+                        const auto itr = m_results.find(m_nextToWrite);
+                        if (itr == m_results.end()) {
+                            return;
+                        }
+
+                        result = std::move(itr->second);
+                        m_results.erase(itr);
+
+                        ++m_nextToWrite;
+                    }
+
+                    output.write(result.data.data(), static_cast<std::streamsize>(result.data.size()));
+
+                    if (!output) {
+                        fail("failed to write to output file");
+                        return;
+                    }
+
+                    ++m_gamesWritten;
+                    m_positionsWritten += result.positions;
+                }
+            }
+        };
+
+        void runWorker(Pipeline& pipeline, const RescoreOptions& options) {
+            Searcher searcher{options.ttSizeMib};
+
+            limit::SearchLimiter limiter{util::Instant::now()};
+            limiter.setSoftNodes(options.softNodes);
+            limiter.setHardNodes(std::max(options.softNodes, kHardNodes));
+            searcher.setLimiter(limiter);
+
+            auto& thread = searcher.take();
+
+            thread.maxDepth = options.depth;
+            thread.datagen = true;
+
+            const auto format = format::createWriter(
+                format::gameFormatFromPath(options.output).value_or(format::GameFormat::kStoatpack)
+            );
+
+            std::vector<u64> keyHistory{};
+            keyHistory.reserve(1024);
+
+            std::ostringstream stream{};
+
+            Job job{};
+
+            while (pipeline.popJob(job)) {
+                const auto& game = job.game;
+
+                const auto fail = [&](std::string_view reason) {
+                    pipeline.fail(fmt::format("game {}: {}", job.index, reason));
+                };
+
+                const auto startpos = game.startPosition();
+
+                if (!startpos) {
+                    fail("invalid start position");
+                    return;
+                }
+
+                searcher.newGame();
+
+                if (game.startpos) {
+                    format->startFromPosition(*startpos);
+                } else {
+                    format->startStandard();
+                }
+
+                auto pos = *startpos;
+                keyHistory.clear();
+
+                for (const auto move : game.unscoredMoves) {
+                    if (!pos.isPseudolegal(move) || !pos.isLegal(move)) {
+                        fail(fmt::format("illegal unscored move {} in {}", move, pos.sfen()));
+                        return;
+                    }
+
+                    format->pushUnscored(move);
+
+                    keyHistory.push_back(pos.key());
+                    pos = pos.applyMove(move);
+                }
+
+                thread.nnueState.reset(pos);
+
+                for (const auto& [move, oldScore] : game.moves) {
+                    if (!pos.isPseudolegal(move) || !pos.isLegal(move)) {
+                        fail(fmt::format("illegal move {} in {}", move, pos.sfen()));
+                        return;
+                    }
+
+                    thread.reset(pos, keyHistory);
+                    searcher.runDatagenSearch();
+
+                    const auto score = thread.pvMove().score;
+                    format->push(move, pos.stm() == Colors::kBlack ? score : -score);
+
+                    keyHistory.push_back(pos.key());
+
+                    eval::nnue::UpdateContext nnueCtx{};
+                    pos = pos.applyMove(move, eval::nnue::BoardObserver{nnueCtx});
+                    thread.nnueState.applyImmediately(nnueCtx, pos);
+                }
+
+                stream.str({});
+                const auto positions = format->writeAllWithOutcome(stream, game.outcome);
+
+                pipeline.pushResult(job.index, {std::move(stream).str(), positions});
+            }
+        }
+
+        i32 Pipeline::run(std::istream& input, std::ostream& output, u64 skippedGames) {
+            const auto threadCount = m_options.threads;
+            const auto window = threadCount * kWindowPerThread;
+
+            const auto reader = format::createReader(m_options.input, input);
+            format::StoatpackGame game{};
+
+            for (u64 i = 0; i < skippedGames; ++i) {
+                if (reader->next(game) != format::ReadResult::kOk) {
+                    fmt::println(stderr, "input has fewer games than the existing output");
+                    return 1;
+                }
+            }
+
+            m_nextToWrite = skippedGames;
+
+            std::vector<std::thread> threads{};
+            threads.reserve(threadCount);
+
+            for (u32 i = 0; i < threadCount; ++i) {
+                threads.emplace_back([this] { runWorker(*this, m_options); });
+            }
+
+            const auto start = util::Instant::now();
+
+            const auto printProgress = [&] {
+                const auto time = start.elapsed();
+                fmt::println(
+                    "rescored {} positions from {} games in {:.6g} sec ({:.6g} pos/sec)",
+                    m_positionsWritten,
+                    m_gamesWritten,
+                    time,
+                    static_cast<f64>(m_positionsWritten) / time
+                );
+            };
+
+            auto nextReport = kReportInterval;
+
+            bool failed = false;
+
+            for (u64 index = skippedGames; !s_stop.load();) {
+                {
+                    std::unique_lock lock{m_mutex};
+                    const auto ready = m_resultSignal.wait_for(lock, kStopPollInterval, [&] {
+                        return index - m_nextToWrite < window || m_results.contains(m_nextToWrite) || m_error;
+                    });
+
+                    if (m_error) {
+                        break;
+                    }
+
+                    if (!ready) {
+                        continue;
+                    }
+                }
+
+                writeReady(output);
+
+                if (m_gamesWritten >= nextReport) {
+                    printProgress();
+                    nextReport = m_gamesWritten + kReportInterval;
+                }
+
+                if (index - m_nextToWrite >= window) {
+                    continue;
+                }
+
+                const auto result = reader->next(game);
+
+                if (result == format::ReadResult::kEnd) {
+                    break;
+                } else if (result == format::ReadResult::kTruncated) {
+                    fmt::println(stderr, "warning: input ends partway through game {}", index);
+                    break;
+                } else if (result == format::ReadResult::kInvalid) {
+                    fmt::println(stderr, "invalid game {} in input", index);
+                    failed = true;
+                    break;
+                }
+
+                {
+                    const std::scoped_lock lock{m_mutex};
+                    m_jobs.push_back({index++, std::move(game)});
+                }
+
+                m_jobSignal.notify_one();
+            }
+
+            {
+                const std::scoped_lock lock{m_mutex};
+
+                // games already being searched are still finished and written
+                if (s_stop.load() || failed || m_error) {
+                    m_jobs.clear();
+                }
+
+                m_inputDone = true;
+            }
+
+            m_jobSignal.notify_all();
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            writeReady(output);
+            output.flush();
+
+            if (!output) {
+                fail("failed to write to output file");
+            }
+
+            printProgress();
+
+            if (m_error) {
+                fmt::println(stderr, "{}", *m_error);
+                return 1;
+            }
+
+            return failed ? 1 : 0;
+        }
+
+        // Counts the complete games in an existing output file, and cuts off any partial one
+        [[nodiscard]] std::optional<u64> prepareOutput(const std::filesystem::path& path) {
+            if (!std::filesystem::exists(path)) {
+                return 0;
+            }
+
+            u64 games{};
+            u64 validBytes{};
+
+            {
+                std::ifstream stream{path, std::ios::binary};
+
+                if (!stream) {
+                    fmt::println(stderr, "failed to open existing output file \"{}\"", path);
+                    return {};
+                }
+
+                const auto reader = format::createReader(path, stream);
+                format::StoatpackGame game{};
+
+                while (true) {
+                    const auto result = reader->next(game);
+
+                    if (result == format::ReadResult::kInvalid) {
+                        fmt::println(stderr, "existing output file \"{}\" is corrupt", path);
+                        return {};
+                    } else if (result != format::ReadResult::kOk) {
+                        break;
+                    }
+
+                    ++games;
+                }
+
+                validBytes = reader->validBytes();
+            }
+
+            if (validBytes != std::filesystem::file_size(path)) {
+                fmt::println("discarding partial game at the end of \"{}\"", path);
+                std::filesystem::resize_file(path, validBytes);
+            }
+
+            return games;
+        }
+    } // namespace
+
+    i32 run(const RescoreOptions& options) {
+        if (!util::signal::setCtrlCHandler([] { s_stop.store(true); })) {
+            return 1;
+        }
+
+        const auto inputPath = std::filesystem::path{options.input};
+        const auto outputPath = std::filesystem::path{options.output};
+
+        std::error_code error{};
+        if (std::filesystem::equivalent(inputPath, outputPath, error)) {
+            fmt::println(stderr, "input and output must be different files");
+            return 1;
+        }
+
+        std::ifstream input{inputPath, std::ios::binary};
+
+        if (!input) {
+            fmt::println(stderr, "failed to open input file \"{}\"", inputPath);
+            return 1;
+        }
+
+        const auto skippedGames = prepareOutput(outputPath);
+
+        if (!skippedGames) {
+            return 1;
+        }
+
+        if (*skippedGames > 0) {
+            fmt::println("resuming after {} games", *skippedGames);
+        }
+
+        std::ofstream output{outputPath, std::ios::binary | std::ios::app};
+
+        if (!output) {
+            fmt::println(stderr, "failed to open output file \"{}\"", outputPath);
+            return 1;
+        }
+
+        Pipeline pipeline{options};
+        const auto result = pipeline.run(input, output, *skippedGames);
+
+        // a resumed run trusts the existing output, so make sure it is actually on disk
+        // (even after a failure, as everything written so far is still valid)
+        if (output && !util::syncFile(outputPath)) {
+            return 1;
+        }
+
+        return result;
+    }
+} // namespace stoat::datagen::rescore
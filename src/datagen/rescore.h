@@ -0,0 +1,47 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <string>
+
+#include "../core.h"
+
+namespace stoat::datagen::rescore {
+    constexpr u32 kDefaultThreads = 1;
+    constexpr usize kDefaultSoftNodes = 15000;
+    constexpr usize kDefaultTtSizeMib = 16;
+
+    struct RescoreOptions {
+        std::string input{};
+        std::string output{};
+        u32 threads{kDefaultThreads};
+        usize softNodes{kDefaultSoftNodes};
+        i32 depth{kMaxDepth};
+        usize ttSizeMib{kDefaultTtSizeMib};
+    };
+
+    // Replays every game in a Stoatpack file, re-searching each scored position, and writes the games
+    // back out in their original order with the new scores and original outcomes. Either file may be
+    // Deltapack instead, picked by its .dpk extension. Each game is searched
+    // start to finish by one thread, keeping its TT and histories warm. Games already in the output
+    // file are skipped, so an interrupted run can be continued by rerunning the same command
+    i32 run(const RescoreOptions& options);
+} // namespace stoat::datagen::rescore
@@ -0,0 +1,215 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "telemetry.h"
+
+#include <chrono>
+#include <string>
+
+#include <fmt/ostream.h>
+#include <fmt/std.h>
+
+namespace stoat::datagen {
+    namespace {
+        constexpr std::array kGameEndNames = {
+            "no_legal_moves",
+            "mate_score",
+            "mate_solver",
+            "win_adjudication",
+            "draw_adjudication",
+            "repetition",
+            "illegal_perpetual",
+            "entering_kings",
+        };
+
+        static_assert(kGameEndNames.size() == static_cast<usize>(GameEnd::kCount));
+
+        [[nodiscard]] f64 rate(u64 count, f64 time) {
+            return time > 0.0 ? static_cast<f64>(count) / time : 0.0;
+        }
+    } // namespace
+
+    void Telemetry::Snapshot::add(const Snapshot& other) {
+        games += other.games;
+        positions += other.positions;
+        nodes += other.nodes;
+
+        for (usize i = 0; i < outcomes.size(); ++i) {
+            outcomes[i] += other.outcomes[i];
+        }
+
+        for (usize i = 0; i < gameEnds.size(); ++i) {
+            gameEnds[i] += other.gameEnds[i];
+        }
+    }
+
+    Telemetry::Telemetry(u32 threadCount) :
+            m_counters{std::make_unique<Counters[]>(threadCount)}, m_threadCount{threadCount} {}
+
+    Telemetry::~Telemetry() {
+        stop();
+    }
+
+    bool Telemetry::start(const std::filesystem::path& path, f64 interval) {
+        assert(!m_thread.joinable());
+
+        m_stream.open(path, std::ios::app);
+
+        if (!m_stream) {
+            fmt::println(stderr, "failed to open telemetry file \"{}\"", path);
+            return false;
+        }
+
+        m_startTime = util::Instant::now();
+        m_lastTotal = {};
+        m_lastTime = 0.0;
+
+        m_stopping = false;
+        m_thread = std::thread{[this, interval] { run(interval); }};
+
+        return true;
+    }
+
+    void Telemetry::stop() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            const std::scoped_lock lock{m_mutex};
+            m_stopping = true;
+        }
+
+        m_signal.notify_one();
+        m_thread.join();
+
+        m_stream.close();
+    }
+
+    Telemetry::Snapshot Telemetry::snapshot(u32 id) const {
+        const auto& counters = m_counters[id];
+
+        Snapshot snapshot{};
+
+        // games first, with acquire - workers count a game's positions, outcome and end
+        // before releasing the game itself, so every game seen here is counted in those too
+        snapshot.games = counters.games.load(std::memory_order::acquire);
+        snapshot.positions = counters.positions.load(std::memory_order::relaxed);
+        snapshot.nodes = counters.nodes.load(std::memory_order::relaxed);
+
+        for (usize i = 0; i < snapshot.outcomes.size(); ++i) {
+            snapshot.outcomes[i] = counters.outcomes[i].load(std::memory_order::relaxed);
+        }
+
+        for (usize i = 0; i < snapshot.gameEnds.size(); ++i) {
+            snapshot.gameEnds[i] = counters.gameEnds[i].load(std::memory_order::relaxed);
+        }
+
+        return snapshot;
+    }
+
+    void Telemetry::run(f64 interval) {
+        const auto duration = std::chrono::duration<f64>{interval};
+
+        std::unique_lock lock{m_mutex};
+
+        while (!m_signal.wait_for(lock, duration, [this] { return m_stopping; })) {
+            report();
+        }
+
+        report();
+    }
+
+    void Telemetry::report() {
+        const auto time = m_startTime.elapsed();
+
+        std::string line{};
+        auto itr = std::back_inserter(line);
+
+        const auto formatSnapshot = [&](const Snapshot& snapshot) {
+            fmt::format_to(
+                itr,
+                R"({{"games": {}, "positions": {}, "nodes": {}, "games_per_sec": {:.4f}, "positions_per_sec": {:.2f}, )"
+                R"("nodes_per_sec": {:.0f}, "avg_game_length": {:.2f}, )",
+                snapshot.games,
+                snapshot.positions,
+                snapshot.nodes,
+                rate(snapshot.games, time),
+                rate(snapshot.positions, time),
+                rate(snapshot.nodes, time),
+                snapshot.games == 0 ? 0.0 : static_cast<f64>(snapshot.positions) / static_cast<f64>(snapshot.games)
+            );
+
+            fmt::format_to(
+                itr,
+                R"("outcomes": {{"black_win": {}, "draw": {}, "black_loss": {}}}, "game_ends": {{)",
+                snapshot.outcomes[static_cast<usize>(format::Outcome::kBlackWin)],
+                snapshot.outcomes[static_cast<usize>(format::Outcome::kDraw)],
+                snapshot.outcomes[static_cast<usize>(format::Outcome::kBlackLoss)]
+            );
+
+            for (usize i = 0; i < kGameEndNames.size(); ++i) {
+                fmt::format_to(itr, R"({}"{}": {})", i == 0 ? "" : ", ", kGameEndNames[i], snapshot.gameEnds[i]);
+            }
+
+            fmt::format_to(itr, "}}}}");
+        };
+
+        Snapshot total{};
+
+        std::vector<Snapshot> threads{};
+        threads.reserve(m_threadCount);
+
+        for (u32 id = 0; id < m_threadCount; ++id) {
+            total.add(threads.emplace_back(snapshot(id)));
+        }
+
+        const auto intervalTime = time - m_lastTime;
+
+        fmt::format_to(
+            itr,
+            R"({{"time": {:.3f}, "threads": {}, "interval": {{"games_per_sec": {:.4f}, "positions_per_sec": {:.2f}, )"
+            R"("nodes_per_sec": {:.0f}}}, "total": )",
+            time,
+            m_threadCount,
+            rate(total.games - m_lastTotal.games, intervalTime),
+            rate(total.positions - m_lastTotal.positions, intervalTime),
+            rate(total.nodes - m_lastTotal.nodes, intervalTime)
+        );
+
+        formatSnapshot(total);
+
+        fmt::format_to(itr, R"(, "per_thread": [)");
+
+        for (u32 id = 0; id < m_threadCount; ++id) {
+            if (id > 0) {
+                fmt::format_to(itr, ", ");
+            }
+
+            formatSnapshot(threads[id]);
+        }
+
+        fmt::format_to(itr, "]}}");
+
+        fmt::println(m_stream, "{}", line);
+        m_stream.flush();
+
+        m_lastTotal = total;
+        m_lastTime = time;
+    }
+} // namespace stoat::datagen
@@ -0,0 +1,126 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../arch.h"
+#include "../util/timer.h"
+#include "format/format.h"
+
+namespace stoat::datagen {
+    // Why a datagen game ended
+    enum class GameEnd : u8 {
+        // the side to move had no legal moves
+        kNoLegalMoves = 0,
+        kMateScore,
+        kMateSolver,
+        kWinAdjudication,
+        kDrawAdjudication,
+        kRepetition,
+        // the search played into a perpetual check, logged to err.txt
+        kIllegalPerpetual,
+        kEnteringKings,
+        kCount,
+    };
+
+    // Aggregates datagen throughput across threads. Workers bump their own counters with relaxed
+    // atomics and never block, and a reporter thread periodically appends a snapshot of every
+    // thread's counters and their totals to a JSON-lines file, one object per line
+    class Telemetry {
+    public:
+        struct alignas(kCacheLineSize) Counters {
+            std::atomic<u64> games{};
+            std::atomic<u64> positions{};
+            std::atomic<u64> nodes{};
+            std::array<std::atomic<u64>, 3> outcomes{};
+            std::array<std::atomic<u64>, static_cast<usize>(GameEnd::kCount)> gameEnds{};
+
+            inline void addNodes(u64 count) {
+                nodes.fetch_add(count, std::memory_order::relaxed);
+            }
+
+            inline void addGame(u64 gamePositions, format::Outcome outcome, GameEnd end) {
+                positions.fetch_add(gamePositions, std::memory_order::relaxed);
+                outcomes[static_cast<usize>(outcome)].fetch_add(1, std::memory_order::relaxed);
+                gameEnds[static_cast<usize>(end)].fetch_add(1, std::memory_order::relaxed);
+                // release, so that a reader that sees this game also sees the counts above
+                games.fetch_add(1, std::memory_order::release);
+            }
+        };
+
+        explicit Telemetry(u32 threadCount);
+        ~Telemetry();
+
+        Telemetry(const Telemetry&) = delete;
+        Telemetry(Telemetry&&) = delete;
+
+        [[nodiscard]] inline Counters& counters(u32 id) {
+            return m_counters[id];
+        }
+
+        // Opens path for appending and starts reporting every interval seconds
+        [[nodiscard]] bool start(const std::filesystem::path& path, f64 interval);
+
+        // Writes a final snapshot and stops the reporter
+        void stop();
+
+    private:
+        struct Snapshot {
+            u64 games{};
+            u64 positions{};
+            u64 nodes{};
+            std::array<u64, 3> outcomes{};
+            std::array<u64, static_cast<usize>(GameEnd::kCount)> gameEnds{};
+
+            void add(const Snapshot& other);
+        };
+
+        std::unique_ptr<Counters[]> m_counters;
+        u32 m_threadCount;
+
+        util::Instant m_startTime{util::Instant::now()};
+
+        std::ofstream m_stream{};
+
+        std::mutex m_mutex{};
+        std::condition_variable m_signal{};
+        bool m_stopping{};
+
+        std::thread m_thread{};
+
+        Snapshot m_lastTotal{};
+        f64 m_lastTime{};
+
+        [[nodiscard]] Snapshot snapshot(u32 id) const;
+
+        void run(f64 interval);
+        void report();
+    };
+} // namespace stoat::datagen
@@ -0,0 +1,569 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tools.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <sstream>
+#include <thread>
+
+#include <fmt/std.h>
+
+#include "format/games.h"
+#include "format/packed_sfen.h"
+#include "format/stoatformat.h"
+#include "format/stoatpack.h"
+
+namespace stoat::datagen::tools {
+    namespace {
+        constexpr usize kReadBufferSize = 1024 * 1024;
+        // 1 MiB of records
+        constexpr usize kConvertChunkSize = 16384;
+        constexpr usize kConvertChunkBytes = 1024 * 1024;
+
+        using PositionVisitor = std::function<void(const Position&, Move, Score, format::Outcome)>;
+        using GameVisitor = std::function<void(const format::StoatpackGame&)>;
+
+        struct FileSummary {
+            u64 games{};
+            u64 positions{};
+
+            std::array<u64, 3> outcomes{};
+            u64 arbitraryStarts{};
+
+            u64 inCheck{};
+            u64 captures{};
+
+            i64 absScoreSum{};
+            Score minScore{kScoreInf};
+            Score maxScore{-kScoreInf};
+
+            u64 written{};
+
+            bool truncated{};
+            std::optional<std::string> error{};
+
+            void add(const FileSummary& other) {
+                games += other.games;
+                positions += other.positions;
+
+                for (usize i = 0; i < outcomes.size(); ++i) {
+                    outcomes[i] += other.outcomes[i];
+                }
+
+                arbitraryStarts += other.arbitraryStarts;
+
+                inCheck += other.inCheck;
+                captures += other.captures;
+
+                absScoreSum += other.absScoreSum;
+                minScore = std::min(minScore, other.minScore);
+                maxScore = std::max(maxScore, other.maxScore);
+
+                written += other.written;
+            }
+
+            void addPosition(const Position& pos, Move move, Score score) {
+                ++positions;
+
+                if (pos.isInCheck()) {
+                    ++inCheck;
+                }
+
+                if (pos.isCapture(move)) {
+                    ++captures;
+                }
+
+                absScoreSum += std::abs(score);
+                minScore = std::min(minScore, score);
+                maxScore = std::max(maxScore, score);
+            }
+        };
+
+        // .bin inputs hold YaneuraOu PackedSfenValue records rather than games
+        [[nodiscard]] bool isPackedSfenPath(const std::string& path) {
+            return std::filesystem::path{path}.extension() == ".bin";
+        }
+
+        // Every record is a separate position, so outcomes are counted per position and no games are counted
+        [[nodiscard]] FileSummary scanPackedSfenFile(std::istream& stream, const PositionVisitor& visitor) {
+            FileSummary summary{};
+
+            format::PackedSfenValue record{};
+            u64 index{};
+
+            while (stream.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+                const auto offset = index * sizeof(record);
+
+                const auto pos = record.unpack();
+
+                if (!pos) {
+                    summary.error = fmt::format("invalid position in record {} at byte {}", index, offset);
+                    break;
+                }
+
+                const auto move = record.unpackMove(*pos);
+
+                if (!move) {
+                    summary.error = fmt::format("illegal move in record {} at byte {}", index, offset);
+                    break;
+                }
+
+                const auto outcome = record.outcome(pos->stm());
+
+                if (!outcome) {
+                    summary.error = fmt::format("invalid game result in record {} at byte {}", index, offset);
+                    break;
+                }
+
+                const Score score = record.senteScore(pos->stm());
+
+                summary.addPosition(*pos, *move, score);
+                ++summary.outcomes[static_cast<usize>(*outcome)];
+
+                if (visitor) {
+                    visitor(*pos, *move, score, *outcome);
+                }
+
+                ++index;
+            }
+
+            if (!summary.error && stream.gcount() > 0) {
+                summary.truncated = true;
+            }
+
+            return summary;
+        }
+
+        // Calls gameVisitor with every game once it has been fully replayed. .bin inputs have no games,
+        // so only the position visitor is called for them
+        [[nodiscard]] FileSummary scanFile(
+            const std::string& path,
+            const PositionVisitor& visitor,
+            const GameVisitor& gameVisitor = {}
+        ) {
+            FileSummary summary{};
+
+            std::vector<char> buffer(kReadBufferSize);
+
+            std::ifstream stream{};
+            stream.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            stream.open(path, std::ios::binary);
+
+            if (!stream) {
+                summary.error = "failed to open file";
+                return summary;
+            }
+
+            if (isPackedSfenPath(path)) {
+                return scanPackedSfenFile(stream, visitor);
+            }
+
+            const auto reader = format::createReader(path, stream);
+            format::StoatpackGame game{};
+
+            while (true) {
+                const auto offset = reader->validBytes();
+                const auto result = reader->next(game);
+
+                if (result == format::ReadResult::kEnd) {
+                    break;
+                } else if (result == format::ReadResult::kTruncated) {
+                    summary.truncated = true;
+                    break;
+                } else if (result == format::ReadResult::kInvalid) {
+                    summary.error = fmt::format("malformed game {} at byte {}", summary.games, offset);
+                    break;
+                }
+
+                const auto error = format::replay(game, [&](const Position& pos, Move move, Score score) {
+                    summary.addPosition(pos, move, score);
+
+                    if (visitor) {
+                        visitor(pos, move, score, game.outcome);
+                    }
+                });
+
+                if (error) {
+                    summary.error = fmt::format("game {} at byte {}: {}", summary.games, offset, *error);
+                    break;
+                }
+
+                ++summary.games;
+                ++summary.outcomes[static_cast<usize>(game.outcome)];
+
+                if (game.startpos) {
+                    ++summary.arbitraryStarts;
+                }
+
+                if (gameVisitor) {
+                    gameVisitor(game);
+                }
+            }
+
+            return summary;
+        }
+
+        // Runs process over every input, spread across options.threads threads
+        [[nodiscard]] std::vector<FileSummary> processFiles(
+            const ToolOptions& options,
+            const std::function<FileSummary(const std::string&)>& process
+        ) {
+            std::vector<FileSummary> summaries(options.inputs.size());
+
+            std::atomic<usize> nextFile{0};
+
+            const auto threadCount = std::min<usize>(std::max<u32>(options.threads, 1), options.inputs.size());
+
+            std::vector<std::thread> threads{};
+            threads.reserve(threadCount);
+
+            for (usize i = 0; i < threadCount; ++i) {
+                threads.emplace_back([&] {
+                    while (true) {
+                        const auto idx = nextFile.fetch_add(1);
+
+                        if (idx >= options.inputs.size()) {
+                            break;
+                        }
+
+                        summaries[idx] = process(options.inputs[idx]);
+                    }
+                });
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            return summaries;
+        }
+
+        // Prints per-file problems, and returns whether any file was invalid
+        [[nodiscard]] bool reportProblems(const ToolOptions& options, std::span<const FileSummary> summaries) {
+            bool failed = false;
+
+            for (usize i = 0; i < summaries.size(); ++i) {
+                const auto& summary = summaries[i];
+
+                if (summary.error) {
+                    fmt::println(stderr, "{}: {}", options.inputs[i], *summary.error);
+                    failed = true;
+                } else if (summary.truncated) {
+                    fmt::println(
+                        stderr,
+                        "warning: {}: file ends partway through a {}",
+                        options.inputs[i],
+                        isPackedSfenPath(options.inputs[i]) ? "record" : "game"
+                    );
+                }
+            }
+
+            return failed;
+        }
+
+        [[nodiscard]] f64 percentage(u64 value, u64 total) {
+            return total == 0 ? 0.0 : static_cast<f64>(value) * 100.0 / static_cast<f64>(total);
+        }
+
+        [[nodiscard]] i32 convertGames(const ToolOptions& options, format::GameFormat gameFormat) {
+            const auto& filter = options.filter;
+
+            if (filter.maxScore || filter.minPly > 0 || filter.skipInCheck || filter.skipCaptures) {
+                fmt::println(stderr, "filters only apply when converting to Stoatformat or PackedSfenValue");
+                return 1;
+            }
+
+            for (const auto& input : options.inputs) {
+                if (isPackedSfenPath(input)) {
+                    fmt::println(stderr, "{}: PackedSfenValue files hold positions, not games", input);
+                    return 1;
+                }
+            }
+
+            std::ofstream output{options.output, std::ios::binary | std::ios::trunc};
+
+            if (!output) {
+                fmt::println(stderr, "failed to open output file \"{}\"", options.output);
+                return 1;
+            }
+
+            std::mutex outputMutex{};
+
+            const auto writeChunk = [&](std::ostringstream& chunk) {
+                const std::scoped_lock lock{outputMutex};
+
+                const auto data = chunk.view();
+                output.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+                chunk.str({});
+            };
+
+            const auto summaries = processFiles(options, [&](const std::string& path) {
+                const auto writer = format::createWriter(gameFormat);
+                std::ostringstream chunk{};
+
+                u64 written{};
+
+                auto summary = scanFile(path, {}, [&](const format::StoatpackGame& game) {
+                    if (game.startpos) {
+                        // already replayed successfully, so this is valid
+                        writer->startFromPosition(*game.startPosition());
+                    } else {
+                        writer->startStandard();
+                    }
+
+                    for (const auto move : game.unscoredMoves) {
+                        writer->pushUnscored(move);
+                    }
+
+                    for (const auto& [move, score] : game.moves) {
+                        writer->push(move, score);
+                    }
+
+                    written += writer->writeAllWithOutcome(chunk, game.outcome);
+
+                    if (chunk.tellp() >= static_cast<std::streamoff>(kConvertChunkBytes)) {
+                        writeChunk(chunk);
+                    }
+                });
+
+                if (chunk.tellp() > 0) {
+                    writeChunk(chunk);
+                }
+
+                summary.written = written;
+
+                return summary;
+            });
+
+            output.flush();
+
+            FileSummary total{};
+
+            for (const auto& summary : summaries) {
+                total.add(summary);
+            }
+
+            fmt::println(
+                "wrote {} games ({} positions) to \"{}\" as {}",
+                total.games,
+                total.written,
+                options.output,
+                gameFormat == format::GameFormat::kDeltapack ? "Deltapack" : "Stoatpack"
+            );
+
+            if (!output) {
+                fmt::println(stderr, "failed to write to output file \"{}\"", options.output);
+                return 1;
+            }
+
+            return reportProblems(options, summaries) ? 1 : 0;
+        }
+
+        // pack(pos, move, senteScore, outcome) returns the record to write, if the position can be stored
+        template <typename Record, typename Pack>
+        [[nodiscard]] i32 convertPositions(const ToolOptions& options, Pack pack) {
+            std::ofstream output{options.output, std::ios::binary | std::ios::trunc};
+
+            if (!output) {
+                fmt::println(stderr, "failed to open output file \"{}\"", options.output);
+                return 1;
+            }
+
+            std::mutex outputMutex{};
+
+            const auto writeChunk = [&](std::vector<Record>& chunk) {
+                const std::scoped_lock lock{outputMutex};
+                output.write(
+                    reinterpret_cast<const char*>(chunk.data()),
+                    static_cast<std::streamsize>(chunk.size() * sizeof(Record))
+                );
+                chunk.clear();
+            };
+
+            const auto& filter = options.filter;
+
+            const auto summaries = processFiles(options, [&](const std::string& path) {
+                std::vector<Record> chunk{};
+                chunk.reserve(kConvertChunkSize);
+
+                u64 written{};
+
+                auto summary = scanFile(
+                    path,
+                    [&](const Position& pos, Move move, Score score, format::Outcome outcome) {
+                        if (filter.maxScore && std::abs(score) > *filter.maxScore) {
+                            return;
+                        }
+
+                        if (pos.moveCount() < filter.minPly) {
+                            return;
+                        }
+
+                        if (filter.skipInCheck && pos.isInCheck()) {
+                            return;
+                        }
+
+                        if (filter.skipCaptures && pos.isCapture(move)) {
+                            return;
+                        }
+
+                        const auto record = pack(pos, move, static_cast<i16>(score), outcome);
+
+                        if (!record) {
+                            return;
+                        }
+
+                        chunk.push_back(*record);
+                        ++written;
+
+                        if (chunk.size() >= kConvertChunkSize) {
+                            writeChunk(chunk);
+                        }
+                    }
+                );
+
+                if (!chunk.empty()) {
+                    writeChunk(chunk);
+                }
+
+                summary.written = written;
+
+                return summary;
+            });
+
+            output.flush();
+
+            FileSummary total{};
+
+            for (const auto& summary : summaries) {
+                total.add(summary);
+            }
+
+            fmt::println(
+                "wrote {} of {} positions ({:.2f}%) from {} games to \"{}\"",
+                total.written,
+                total.positions,
+                percentage(total.written, total.positions),
+                total.games,
+                options.output
+            );
+
+            if (!output) {
+                fmt::println(stderr, "failed to write to output file \"{}\"", options.output);
+                return 1;
+            }
+
+            return reportProblems(options, summaries) ? 1 : 0;
+        }
+    } // namespace
+
+    i32 validate(const ToolOptions& options) {
+        const auto summaries = processFiles(options, [](const std::string& path) { return scanFile(path, {}); });
+
+        for (usize i = 0; i < summaries.size(); ++i) {
+            const auto& summary = summaries[i];
+            fmt::println(
+                "{}: {} games, {} positions{}",
+                options.inputs[i],
+                summary.games,
+                summary.positions,
+                summary.error ? " (invalid)" : ""
+            );
+        }
+
+        if (reportProblems(options, summaries)) {
+            return 1;
+        }
+
+        fmt::println("all files valid");
+
+        return 0;
+    }
+
+    i32 stats(const ToolOptions& options) {
+        const auto summaries = processFiles(options, [](const std::string& path) { return scanFile(path, {}); });
+
+        FileSummary total{};
+
+        for (usize i = 0; i < summaries.size(); ++i) {
+            const auto& summary = summaries[i];
+            fmt::println("{}: {} games, {} positions", options.inputs[i], summary.games, summary.positions);
+            total.add(summary);
+        }
+
+        const auto games = total.games;
+        const auto positions = total.positions;
+
+        // per game, or per position for .bin inputs
+        const auto outcomes = std::accumulate(total.outcomes.begin(), total.outcomes.end(), u64{});
+
+        fmt::println("");
+        fmt::println("games:       {} ({} from arbitrary positions)", games, total.arbitraryStarts);
+        fmt::println(
+            "positions:   {} ({:.2f} per game)",
+            positions,
+            games == 0 ? 0.0 : static_cast<f64>(positions) / static_cast<f64>(games)
+        );
+        fmt::println(
+            "outcomes:    black wins {:.2f}%, draws {:.2f}%, black losses {:.2f}%",
+            percentage(total.outcomes[static_cast<usize>(format::Outcome::kBlackWin)], outcomes),
+            percentage(total.outcomes[static_cast<usize>(format::Outcome::kDraw)], outcomes),
+            percentage(total.outcomes[static_cast<usize>(format::Outcome::kBlackLoss)], outcomes)
+        );
+        fmt::println("in check:    {:.2f}%", percentage(total.inCheck, positions));
+        fmt::println("captures:    {:.2f}%", percentage(total.captures, positions));
+
+        if (positions > 0) {
+            fmt::println(
+                "scores:      mean absolute {:.1f}, min {}, max {}",
+                static_cast<f64>(total.absScoreSum) / static_cast<f64>(positions),
+                total.minScore,
+                total.maxScore
+            );
+        }
+
+        return reportProblems(options, summaries) ? 1 : 0;
+    }
+
+    i32 convert(const ToolOptions& options) {
+        if (const auto gameFormat = format::gameFormatFromPath(options.output)) {
+            return convertGames(options, *gameFormat);
+        }
+
+        if (std::filesystem::path{options.output}.extension() == ".bin") {
+            return convertPositions<format::PackedSfenValue>(options, format::PackedSfenValue::pack);
+        }
+
+        return convertPositions<format::StoatformatRecord>(
+            options,
+            [](const Position& pos, Move, i16 senteScore, format::Outcome outcome) {
+                return std::optional{format::StoatformatRecord::pack(pos, senteScore, outcome)};
+            }
+        );
+    }
+} // namespace stoat::datagen::tools
@@ -0,0 +1,66 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../core.h"
+
+namespace stoat::datagen::tools {
+    struct ConvertFilter {
+        // positions with a greater absolute score are dropped
+        std::optional<Score> maxScore{};
+        // positions with a lower move count are dropped
+        u32 minPly{};
+        bool skipInCheck{};
+        // positions where the move played was a capture
+        bool skipCaptures{};
+    };
+
+    struct ToolOptions {
+        std::vector<std::string> inputs{};
+        u32 threads{1};
+
+        // convert only
+        std::string output{};
+        ConvertFilter filter{};
+    };
+
+    // All of these read Stoatpack or Deltapack (.dpk) files and replay every game
+    // through Position, processing up to options.threads files in parallel. Inputs ending
+    // in .bin are read as YaneuraOu PackedSfenValue records instead, each a separate position
+    // whose outcome is counted on its own
+
+    // Reports any malformed, truncated or illegal games
+    i32 validate(const ToolOptions& options);
+
+    // Prints game and position counts, outcomes and score statistics per file and in total
+    i32 stats(const ToolOptions& options);
+
+    // Writes every scored position that passes the filter to a single Stoatformat file. Records from
+    // each input stay in order, but records from different inputs are interleaved in large chunks.
+    // If the output ends in .bin, positions are written as YaneuraOu PackedSfenValue records instead, skipping
+    // any that are missing pieces. If it ends in .spk or .dpk, whole games are written in that format, unfiltered,
+    // which .bin inputs cannot provide
+    i32 convert(const ToolOptions& options);
+} // namespace stoat::datagen::tools
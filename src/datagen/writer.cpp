@@ -0,0 +1,266 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "writer.h"
+
+#include <cassert>
+
+#include <fmt/std.h>
+
+#include "../util/file_sync.h"
+
+namespace stoat::datagen {
+    AsyncWriter::BatchStreambuf::int_type AsyncWriter::BatchStreambuf::overflow(int_type c) {
+        assert(m_target);
+
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            m_target->push_back(traits_type::to_char_type(c));
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize AsyncWriter::BatchStreambuf::xsputn(const char_type* s, std::streamsize count) {
+        assert(m_target);
+        m_target->insert(m_target->end(), s, s + count);
+        return count;
+    }
+
+    AsyncWriter::ThreadBuffer::ThreadBuffer(AsyncWriter& writer, u32 id) :
+            m_writer{writer}, m_stream{&m_streambuf} {
+        for (auto& batch : m_batches) {
+            batch.threadId = id;
+            // leave room for the game that takes the buffer over the limit
+            batch.data.reserve(kBatchSize + kBatchSize / 4);
+        }
+
+        m_streambuf.setTarget(m_batches[m_active].data);
+    }
+
+    void AsyncWriter::ThreadBuffer::commit(const Checkpoint& checkpoint) {
+        m_batches[m_active].checkpoint = checkpoint;
+
+        if (m_batches[m_active].data.size() >= kBatchSize) {
+            submit();
+        }
+    }
+
+    void AsyncWriter::ThreadBuffer::submit() {
+        auto& full = m_batches[m_active];
+
+        if (full.data.empty()) {
+            return;
+        }
+
+        m_writer.enqueue(full);
+
+        m_active ^= 1;
+        auto& next = m_batches[m_active];
+
+        // only blocks if the I/O thread has fallen a full buffer behind
+        m_writer.waitForRelease(next);
+
+        next.data.clear();
+        next.checkpoint.reset();
+
+        m_streambuf.setTarget(next.data);
+    }
+
+    AsyncWriter::AsyncWriter(u32 threadCount) :
+            m_queueCapacity{threadCount} {
+        m_buffers.reserve(threadCount);
+
+        for (u32 id = 0; id < threadCount; ++id) {
+            m_buffers.push_back(std::make_unique<ThreadBuffer>(*this, id));
+        }
+    }
+
+    AsyncWriter::~AsyncWriter() {
+        finish();
+    }
+
+    bool AsyncWriter::start(const std::filesystem::path& outDir, std::string_view extension) {
+        assert(!m_ioThread.joinable());
+
+        m_files.clear();
+        m_files.reserve(m_buffers.size());
+
+        for (u32 id = 0; id < m_buffers.size(); ++id) {
+            auto& file = m_files.emplace_back();
+
+            file.path = outDir / fmt::format("{}.{}", id, extension);
+            file.checkpointPath = outDir / fmt::format("{}.ckpt", id);
+
+            // writes are already batched, so skip the stream's own buffering
+            file.stream.rdbuf()->pubsetbuf(nullptr, 0);
+            file.stream.open(file.path, std::ios::binary | std::ios::app);
+
+            if (!file.stream) {
+                fmt::println(stderr, "failed to open output file \"{}\"", file.path);
+                return false;
+            }
+
+            std::error_code error{};
+            const auto size = std::filesystem::file_size(file.path, error);
+
+            file.offset = error ? 0 : size;
+        }
+
+        m_stopping = false;
+        m_ioThread = std::thread{[this] { runIoThread(); }};
+
+        return true;
+    }
+
+    void AsyncWriter::finish() {
+        if (!m_ioThread.joinable()) {
+            return;
+        }
+
+        {
+            const std::scoped_lock lock{m_mutex};
+            m_stopping = true;
+        }
+
+        m_queueSignal.notify_one();
+        m_ioThread.join();
+    }
+
+    void AsyncWriter::enqueue(Batch& batch) {
+        {
+            std::unique_lock lock{m_mutex};
+            m_releaseSignal.wait(lock, [this] { return m_queue.size() < m_queueCapacity; });
+
+            assert(!batch.inFlight);
+
+            batch.inFlight = true;
+            m_queue.push_back(&batch);
+        }
+
+        m_queueSignal.notify_one();
+    }
+
+    void AsyncWriter::waitForRelease(const Batch& batch) {
+        std::unique_lock lock{m_mutex};
+        m_releaseSignal.wait(lock, [&batch] { return !batch.inFlight; });
+    }
+
+    void AsyncWriter::runIoThread() {
+        while (true) {
+            Batch* batch{};
+
+            {
+                std::unique_lock lock{m_mutex};
+                m_queueSignal.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+
+                // only stop once everything submitted has been written
+                if (m_queue.empty()) {
+                    break;
+                }
+
+                batch = m_queue.front();
+                m_queue.pop_front();
+            }
+
+            auto& file = m_files[batch->threadId];
+
+            if (batch->checkpoint) {
+                auto& checkpoint = file.checkpoints.emplace_back(*batch->checkpoint);
+                checkpoint.bytes = file.offset + file.pending.size() + batch->data.size();
+            }
+
+            write(file, batch->data);
+            saveCheckpoint(file);
+
+            {
+                const std::scoped_lock lock{m_mutex};
+                batch->inFlight = false;
+            }
+
+            m_releaseSignal.notify_all();
+        }
+
+        for (auto& file : m_files) {
+            writeRemaining(file);
+            saveCheckpoint(file);
+            file.stream.close();
+        }
+    }
+
+    void AsyncWriter::write(OutputFile& file, std::span<const char> data) {
+        file.pending.insert(file.pending.end(), data.begin(), data.end());
+
+        // write up to the last block boundary, and hold on to the rest
+        const auto end = file.offset + file.pending.size();
+        const auto alignedEnd = end / kBlockSize * kBlockSize;
+
+        if (alignedEnd <= file.offset) {
+            return;
+        }
+
+        const auto size = static_cast<usize>(alignedEnd - file.offset);
+
+        file.stream.write(file.pending.data(), static_cast<std::streamsize>(size));
+
+        if (!file.stream) {
+            fmt::println(stderr, "failed to write to output file \"{}\"", file.path);
+        }
+
+        file.pending.erase(file.pending.begin(), file.pending.begin() + static_cast<std::ptrdiff_t>(size));
+        file.offset = alignedEnd;
+    }
+
+    void AsyncWriter::writeRemaining(OutputFile& file) {
+        if (!file.pending.empty()) {
+            file.stream.write(file.pending.data(), static_cast<std::streamsize>(file.pending.size()));
+
+            file.offset += file.pending.size();
+            file.pending.clear();
+        }
+
+        file.stream.flush();
+
+        if (!file.stream) {
+            fmt::println(stderr, "failed to write to output file \"{}\"", file.path);
+            return;
+        }
+
+        // make sure the output survives a crash of the host, not just of this process
+        util::syncFile(file.path);
+    }
+
+    void AsyncWriter::saveCheckpoint(OutputFile& file) {
+        std::optional<Checkpoint> latest{};
+
+        while (!file.checkpoints.empty() && file.checkpoints.front().bytes <= file.offset) {
+            latest = file.checkpoints.front();
+            file.checkpoints.pop_front();
+        }
+
+        if (!latest) {
+            return;
+        }
+
+        // the checkpoint must never point past data that has not reached the disk
+        // yet, or a crash would leave a run that refuses to resume. failures are
+        // reported, and the next save may well succeed
+        if (util::syncFile(file.path)) {
+            latest->save(file.checkpointPath);
+        }
+    }
+} // namespace stoat::datagen
@@ -0,0 +1,157 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.h"
+
+namespace stoat::datagen {
+    // Moves datagen output off the search threads. Each thread serialises games into one of
+    // two in-memory buffers, and full buffers are handed to a dedicated I/O thread over a
+    // bounded queue while the thread carries on filling the other one. The I/O thread issues
+    // large writes aligned to the file's block boundaries, only leaving a partial block behind
+    // until the writer is finished. Each thread's checkpoint is saved alongside its output
+    // file once everything up to it has been written and synced to disk
+    class AsyncWriter {
+    private:
+        struct Batch {
+            u32 threadId{};
+            // guarded by m_mutex
+            bool inFlight{};
+            std::vector<char> data{};
+            // the state after the last game in data
+            std::optional<Checkpoint> checkpoint{};
+        };
+
+        class BatchStreambuf final : public std::streambuf {
+        public:
+            inline void setTarget(std::vector<char>& target) {
+                m_target = &target;
+            }
+
+        protected:
+            int_type overflow(int_type c) final;
+            std::streamsize xsputn(const char_type* s, std::streamsize count) final;
+
+        private:
+            std::vector<char>* m_target{};
+        };
+
+    public:
+        class ThreadBuffer {
+        public:
+            ThreadBuffer(AsyncWriter& writer, u32 id);
+
+            ThreadBuffer(const ThreadBuffer&) = delete;
+            ThreadBuffer(ThreadBuffer&&) = delete;
+
+            [[nodiscard]] inline std::ostream& stream() {
+                return m_stream;
+            }
+
+            // Call after each complete game, with the thread's state for the next one (the
+            // writer fills in the byte offset). Hands the active buffer over to the I/O
+            // thread once it has filled up
+            void commit(const Checkpoint& checkpoint);
+
+            // Hands over anything buffered, regardless of size
+            void submit();
+
+        private:
+            AsyncWriter& m_writer;
+
+            std::array<Batch, 2> m_batches{};
+            u32 m_active{};
+
+            BatchStreambuf m_streambuf{};
+            std::ostream m_stream;
+        };
+
+        explicit AsyncWriter(u32 threadCount);
+        ~AsyncWriter();
+
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter(AsyncWriter&&) = delete;
+
+        // Opens (for appending) one output file per thread in outDir, named {id}.{extension},
+        // with checkpoints in {id}.ckpt, and starts the I/O thread
+        [[nodiscard]] bool start(const std::filesystem::path& outDir, std::string_view extension);
+
+        [[nodiscard]] inline ThreadBuffer& buffer(u32 id) {
+            return *m_buffers[id];
+        }
+
+        // Waits for everything submitted so far to be written, then flushes, syncs to disk
+        // and closes the output files. Datagen threads must have submitted their last buffers
+        void finish();
+
+    private:
+        struct OutputFile {
+            std::ofstream stream{};
+            std::filesystem::path path{};
+            std::filesystem::path checkpointPath{};
+            // bytes actually written to the file so far
+            u64 offset{};
+            // the last partial block
+            std::vector<char> pending{};
+            // checkpoints waiting for their games to be written, oldest first
+            std::deque<Checkpoint> checkpoints{};
+        };
+
+        static constexpr usize kBatchSize = 256 * 1024;
+        static constexpr usize kBlockSize = 4096;
+
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers{};
+        std::vector<OutputFile> m_files{};
+
+        std::mutex m_mutex{};
+        std::condition_variable m_queueSignal{};
+        std::condition_variable m_releaseSignal{};
+
+        std::deque<Batch*> m_queue{};
+        usize m_queueCapacity;
+
+        bool m_stopping{false};
+        std::thread m_ioThread{};
+
+        void enqueue(Batch& batch);
+        void waitForRelease(const Batch& batch);
+
+        void runIoThread();
+        void write(OutputFile& file, std::span<const char> data);
+        void writeRemaining(OutputFile& file);
+        void saveCheckpoint(OutputFile& file);
+    };
+} // namespace stoat::datagen
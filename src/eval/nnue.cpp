@@ -36,6 +36,7 @@
     #undef ST_MSVC
 #endif
 
+#include "../perf_counters.h"
 #include "../util/multi_array.h"
 
 namespace {
@@ -87,6 +88,8 @@ namespace stoat::eval::nnue {
         }
 
         [[nodiscard]] i32 forward(const Accumulator& acc, Color stm) {
+            const perf::ScopedPhase phase{perf::Phase::kNnueForward};
+
             static constexpr auto kChunkSize8 = sizeof(__m256i) / sizeof(i8);
             static constexpr auto kChunkSize16 = sizeof(__m256i) / sizeof(i16);
             static constexpr auto kChunkSize32 = sizeof(__m256i) / sizeof(i32);
@@ -470,14 +473,18 @@ namespace stoat::eval::nnue {
 
     void NnueState::applyImmediately(const UpdateContext& ctx, const Position& pos) {
         assert(m_top);
-        assert(m_top != &m_accStacc[0]);
+
+        // the top accumulator must be fully up to date for this to be valid
+        assert(!m_top->isDirty(Colors::kBlack));
+        assert(!m_top->isDirty(Colors::kWhite));
+
         for (const auto c : {Colors::kBlack, Colors::kWhite}) {
-            if (m_top->ctx.updates.requiresRefresh(c)) {
-                m_top->acc.reset(pos, c);
+            if (ctx.updates.requiresRefresh(c)) {
+                refresh(c, *m_top, pos);
             } else {
+                // in place - each element only depends on its own previous value
                 applyUpdates(c, ctx.updates, m_top->acc, *m_top);
             }
-            m_top->setUpdated(c);
         }
     }
 
@@ -488,6 +495,8 @@ namespace stoat::eval::nnue {
     }
 
     void NnueState::ensureUpToDate(const Position& pos) {
+        const perf::ScopedPhase phase{perf::Phase::kNnueUpdate};
+
         for (const auto c : {Colors::kBlack, Colors::kWhite}) {
             if (!m_top->isDirty(c)) {
                 continue;
@@ -515,6 +524,10 @@ namespace stoat::eval::nnue {
         }
     }
 
+    i32 evaluateAccumulator(const Accumulator& acc, Color stm) {
+        return forward(acc, stm);
+    }
+
     i32 evaluateOnce(const Position& pos) {
         Accumulator acc{};
         acc.reset(pos);
@@ -198,17 +198,22 @@ namespace stoat::eval::nnue {
         BoardObserver push();
         void pop();
 
+        // Applies the updates from a move made with an observer from ctx directly to the top
+        // accumulator, without pushing a new one. Used to advance the root position
         void applyImmediately(const UpdateContext& ctx, const Position& pos);
 
         [[nodiscard]] i32 evaluate(const Position& pos);
 
+        void ensureUpToDate(const Position& pos);
+
     private:
         std::vector<UpdatableAccumulator> m_accStacc{};
         UpdatableAccumulator* m_top{nullptr};
-
-        void ensureUpToDate(const Position& pos);
     };
 
+    // Runs the network on an accumulator that is already up to date
+    [[nodiscard]] i32 evaluateAccumulator(const Accumulator& acc, Color stm);
+
     [[nodiscard]] i32 evaluateOnce(const Position& pos);
 
     [[nodiscard]] constexpr bool requiresRefresh(Color c, Square kingSq, Square prevKingSq) {
@@ -24,7 +24,11 @@
 
 #include "bench.h"
 #include "datagen/datagen.h"
+#include "datagen/rescore.h"
+#include "datagen/tools.h"
+#include "perft.h"
 #include "protocol/handler.h"
+#include "speedtest.h"
 #include "util/ctrlc.h"
 #include "util/parse.h"
 #include "util/split.h"
@@ -35,23 +39,414 @@ namespace stoat {
             std::setvbuf(stdout, nullptr, _IONBF, 0);
         }
 
+        i32 runBench(std::span<const std::string_view> args) {
+            const auto printUsage = [&] {
+                fmt::println(
+                    stderr,
+                    "usage: {} bench [depth] [depth <depth>] [threads <threads>] [hash <mib>] [file <sfen file>] "
+                    "[runs <runs>] [format text|json|csv]",
+                    args[0]
+                );
+            };
+
+            bench::BenchOptions options{};
+
+            usize idx = 2;
+
+            // bare depth, for compatibility with the usual "bench <depth>"
+            if (idx < args.size() && util::tryParse(options.depth, args[idx])) {
+                if (options.depth <= 0) {
+                    fmt::println(stderr, "invalid depth \"{}\"", args[idx]);
+                    printUsage();
+                    return 1;
+                }
+
+                ++idx;
+            }
+
+            for (; idx < args.size(); idx += 2) {
+                const auto name = args[idx];
+
+                if (idx + 1 >= args.size()) {
+                    fmt::println(stderr, "missing value for \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                const auto value = args[idx + 1];
+
+                bool valid = true;
+
+                if (name == "depth") {
+                    valid = util::tryParse(options.depth, value) && options.depth > 0;
+                } else if (name == "threads") {
+                    valid = util::tryParse(options.threads, value) && kThreadCountRange.contains(options.threads);
+                } else if (name == "hash") {
+                    valid = util::tryParse(options.ttSizeMib, value) && tt::kTtSizeRange.contains(options.ttSizeMib);
+                } else if (name == "runs") {
+                    valid = util::tryParse(options.runs, value) && options.runs > 0;
+                } else if (name == "file") {
+                    options.sfenFile = std::string{value};
+                } else if (name == "format") {
+                    if (value == "text") {
+                        options.format = bench::OutputFormat::kText;
+                    } else if (value == "json") {
+                        options.format = bench::OutputFormat::kJson;
+                    } else if (value == "csv") {
+                        options.format = bench::OutputFormat::kCsv;
+                    } else {
+                        valid = false;
+                    }
+                } else {
+                    fmt::println(stderr, "unknown bench option \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                if (!valid) {
+                    fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            return bench::run(options);
+        }
+
+        i32 runSpeedtest(std::span<const std::string_view> args) {
+            const auto printUsage = [&] {
+                fmt::println(
+                    stderr,
+                    "usage: {} speedtest [threads <threads>] [hash <mib>] [movetime <ms>] [file <sfen file>]",
+                    args[0]
+                );
+            };
+
+            speedtest::SpeedtestOptions options{};
+
+            for (usize idx = 2; idx < args.size(); idx += 2) {
+                const auto name = args[idx];
+
+                if (idx + 1 >= args.size()) {
+                    fmt::println(stderr, "missing value for \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                const auto value = args[idx + 1];
+
+                bool valid = true;
+
+                if (name == "threads") {
+                    valid = util::tryParse(options.threads, value)
+                         && (options.threads == 0 || kThreadCountRange.contains(options.threads));
+                } else if (name == "hash") {
+                    valid = util::tryParse(options.ttSizeMib, value) && tt::kTtSizeRange.contains(options.ttSizeMib);
+                } else if (name == "movetime") {
+                    valid = util::tryParse(options.moveTimeMs, value) && options.moveTimeMs > 0;
+                } else if (name == "file") {
+                    options.sfenFile = std::string{value};
+                } else {
+                    fmt::println(stderr, "unknown speedtest option \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                if (!valid) {
+                    fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            return speedtest::run(options);
+        }
+
         i32 runDatagen(std::span<const std::string_view> args) {
-            const auto printUsage = [&] { fmt::println(stderr, "usage: {} datagen <path> [threads]", args[0]); };
+            const auto printUsage = [&] {
+                fmt::println(
+                    stderr,
+                    "usage: {} datagen <path> [threads] [format stoatpack|deltapack] [book <opening file>] "
+                    "[mateprobe <nodes>] [seed <seed>] [resume on|off]",
+                    args[0]
+                );
+            };
+
+            if (args.size() < 3) {
+                printUsage();
+                return 1;
+            }
+
+            datagen::DatagenOptions options{};
+            options.output = std::string{args[2]};
+
+            usize idx = 3;
+
+            // bare thread count, for compatibility
+            if (idx < args.size() && util::tryParse(options.threads, args[idx])) {
+                ++idx;
+            }
+
+            for (; idx < args.size(); idx += 2) {
+                const auto name = args[idx];
+
+                if (idx + 1 >= args.size()) {
+                    fmt::println(stderr, "missing value for \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                const auto value = args[idx + 1];
+
+                if (name == "format") {
+                    if (value == "stoatpack") {
+                        options.format = datagen::format::GameFormat::kStoatpack;
+                    } else if (value == "deltapack") {
+                        options.format = datagen::format::GameFormat::kDeltapack;
+                    } else {
+                        fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                        printUsage();
+                        return 1;
+                    }
+                } else if (name == "book") {
+                    options.bookFile = std::string{value};
+                } else if (name == "mateprobe") {
+                    if (!util::tryParse(options.mateProbeNodes, value)) {
+                        fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                        printUsage();
+                        return 1;
+                    }
+                } else if (name == "seed") {
+                    if (!util::tryParse(options.seed.emplace(), value)) {
+                        fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                        printUsage();
+                        return 1;
+                    }
+                } else if (name == "resume") {
+                    if (value != "on" && value != "off") {
+                        fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                        printUsage();
+                        return 1;
+                    }
+
+                    options.resume = value == "on";
+                } else {
+                    fmt::println(stderr, "unknown datagen option \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            return datagen::run(options);
+        }
+
+        i32 runRescore(std::span<const std::string_view> args) {
+            const auto printUsage = [&] {
+                fmt::println(
+                    stderr,
+                    "usage: {} rescore <input> <output> [threads <threads>] [nodes <soft nodes>] [depth <depth>] "
+                    "[hash <mib>]",
+                    args[0]
+                );
+            };
+
+            if (args.size() < 4) {
+                printUsage();
+                return 1;
+            }
+
+            datagen::rescore::RescoreOptions options{};
+
+            options.input = std::string{args[2]};
+            options.output = std::string{args[3]};
+
+            for (usize idx = 4; idx < args.size(); idx += 2) {
+                const auto name = args[idx];
+
+                if (idx + 1 >= args.size()) {
+                    fmt::println(stderr, "missing value for \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                const auto value = args[idx + 1];
+
+                bool valid = true;
+
+                if (name == "threads") {
+                    valid = util::tryParse(options.threads, value) && kThreadCountRange.contains(options.threads);
+                } else if (name == "nodes") {
+                    valid = util::tryParse(options.softNodes, value) && options.softNodes > 0;
+                } else if (name == "depth") {
+                    valid = util::tryParse(options.depth, value) && options.depth > 0 && options.depth <= kMaxDepth;
+                } else if (name == "hash") {
+                    valid = util::tryParse(options.ttSizeMib, value) && tt::kTtSizeRange.contains(options.ttSizeMib);
+                } else {
+                    fmt::println(stderr, "unknown rescore option \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                if (!valid) {
+                    fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            return datagen::rescore::run(options);
+        }
+
+        // validate, stats and convert
+        i32 runDataTool(std::span<const std::string_view> args) {
+            const auto subcommand = args[1];
+            const bool convert = subcommand == "convert";
+
+            const auto printUsage = [&] {
+                if (convert) {
+                    fmt::println(
+                        stderr,
+                        "usage: {} convert <output> <inputs...> [threads <threads>] [maxscore <score>] "
+                        "[minply <ply>] [incheck keep|skip] [captures keep|skip]",
+                        args[0]
+                    );
+                } else {
+                    fmt::println(stderr, "usage: {} {} <inputs...> [threads <threads>]", args[0], subcommand);
+                }
+            };
+
+            datagen::tools::ToolOptions options{};
+
+            usize idx = 2;
+
+            if (convert) {
+                if (args.size() < 3) {
+                    printUsage();
+                    return 1;
+                }
+
+                options.output = std::string{args[idx++]};
+            }
+
+            const auto parseKeepSkip = [](bool& dst, std::string_view value) {
+                if (value == "keep") {
+                    dst = false;
+                } else if (value == "skip") {
+                    dst = true;
+                } else {
+                    return false;
+                }
+
+                return true;
+            };
+
+            for (; idx < args.size(); ++idx) {
+                const auto name = args[idx];
+
+                const bool isOption = name == "threads"
+                                   || (convert
+                                       && (name == "maxscore" || name == "minply" || name == "incheck"
+                                           || name == "captures"));
+
+                if (!isOption) {
+                    options.inputs.emplace_back(name);
+                    continue;
+                }
+
+                if (++idx >= args.size()) {
+                    fmt::println(stderr, "missing value for \"{}\"", name);
+                    printUsage();
+                    return 1;
+                }
+
+                const auto value = args[idx];
+
+                bool valid = true;
+
+                if (name == "threads") {
+                    valid = util::tryParse(options.threads, value) && kThreadCountRange.contains(options.threads);
+                } else if (name == "maxscore") {
+                    Score maxScore{};
+                    valid = util::tryParse(maxScore, value) && maxScore >= 0;
+                    options.filter.maxScore = maxScore;
+                } else if (name == "minply") {
+                    valid = util::tryParse(options.filter.minPly, value);
+                } else if (name == "incheck") {
+                    valid = parseKeepSkip(options.filter.skipInCheck, value);
+                } else if (name == "captures") {
+                    valid = parseKeepSkip(options.filter.skipCaptures, value);
+                }
+
+                if (!valid) {
+                    fmt::println(stderr, "invalid {} \"{}\"", name, value);
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            if (options.inputs.empty()) {
+                printUsage();
+                return 1;
+            }
+
+            if (convert) {
+                return datagen::tools::convert(options);
+            } else if (subcommand == "stats") {
+                return datagen::tools::stats(options);
+            } else {
+                return datagen::tools::validate(options);
+            }
+        }
+
+        i32 runPerft(std::span<const std::string_view> args) {
+            const auto printUsage = [&] {
+                fmt::println(stderr, "usage: {} perft <depth> [threads] [hash] [sfen]", args[0]);
+            };
 
             if (args.size() < 3) {
                 printUsage();
                 return 1;
             }
 
-            u32 threads = 1;
+            i32 depth{};
+
+            if (!util::tryParse(depth, args[2])) {
+                fmt::println(stderr, "invalid depth \"{}\"", args[2]);
+                printUsage();
+                return 1;
+            }
+
+            PerftOptions options{};
 
-            if (args.size() >= 4 && !util::tryParse(threads, args[3])) {
+            if (args.size() >= 4 && !util::tryParse(options.threads, args[3])) {
                 fmt::println(stderr, "invalid thread count \"{}\"", args[3]);
                 printUsage();
                 return 1;
             }
 
-            return datagen::run(args[2], threads);
+            if (args.size() >= 5 && !util::tryParse(options.hashMib, args[4])) {
+                fmt::println(stderr, "invalid hash size \"{}\"", args[4]);
+                printUsage();
+                return 1;
+            }
+
+            auto pos = Position::startpos();
+
+            if (args.size() >= 6) {
+                std::vector<std::string_view> sfen{args.begin() + 5, args.end()};
+
+                auto result = Position::fromSfenParts(sfen);
+                if (!result) {
+                    fmt::println(stderr, "invalid sfen: {}", result.takeErr().message());
+                    return 1;
+                }
+
+                pos = result.take();
+            }
+
+            perft(pos, depth, options);
+
+            return 0;
         }
 
         // :doom:
@@ -77,10 +472,17 @@ namespace stoat {
         if (args.size() > 1) {
             const auto subcommand = args[1];
             if (subcommand == "bench") {
-                bench::run();
-                return 0;
+                return runBench(args);
             } else if (subcommand == "datagen") {
                 return runDatagen(args);
+            } else if (subcommand == "rescore") {
+                return runRescore(args);
+            } else if (subcommand == "validate" || subcommand == "stats" || subcommand == "convert") {
+                return runDataTool(args);
+            } else if (subcommand == "speedtest") {
+                return runSpeedtest(args);
+            } else if (subcommand == "perft") {
+                return runPerft(args);
             }
         }
 
@@ -19,6 +19,7 @@
 #include "movegen.h"
 
 #include "attacks/attacks.h"
+#include "perf_counters.h"
 #include "rays.h"
 
 namespace stoat::movegen {
@@ -162,9 +163,9 @@ namespace stoat::movegen {
         }
 
         template <bool kGenerateUnlikelyMove>
-        void generatePawns(MoveList& dst, const Position& pos, Bitboard dstMask) {
+        void generatePawns(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
             const auto stm = pos.stm();
-            const auto pawns = pos.pieceBb(PieceTypes::kPawn, stm);
+            const auto pawns = pos.pieceBb(PieceTypes::kPawn, stm) & movable;
 
             const auto shifted = pawns.shiftNorthRelative(stm) & dstMask;
 
@@ -179,8 +180,8 @@ namespace stoat::movegen {
         }
 
         template <bool kGenerateUnlikelyMove>
-        void generateLances(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto lances = pos.pieceBb(PieceTypes::kLance, pos.stm());
+        void generateLances(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto lances = pos.pieceBb(PieceTypes::kLance, pos.stm()) & movable;
             generatePrecalculatedWithColorAndOcc<true>(
                 dst,
                 pos,
@@ -192,8 +193,8 @@ namespace stoat::movegen {
             );
         }
 
-        void generateKnights(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto knights = pos.pieceBb(PieceTypes::kKnight, pos.stm());
+        void generateKnights(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto knights = pos.pieceBb(PieceTypes::kKnight, pos.stm()) & movable;
             generatePrecalculatedWithColor<true>(
                 dst,
                 pos,
@@ -204,23 +205,24 @@ namespace stoat::movegen {
             );
         }
 
-        void generateSilvers(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto silvers = pos.pieceBb(PieceTypes::kSilver, pos.stm());
+        void generateSilvers(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto silvers = pos.pieceBb(PieceTypes::kSilver, pos.stm()) & movable;
             generatePrecalculatedWithColor<true>(dst, pos, silvers, attacks::silverAttacks, dstMask);
         }
 
-        void generateGolds(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto golds = pos.pieceBb(PieceTypes::kGold, pos.stm())
-                             | pos.pieceBb(PieceTypes::kPromotedPawn, pos.stm())
-                             | pos.pieceBb(PieceTypes::kPromotedLance, pos.stm())
-                             | pos.pieceBb(PieceTypes::kPromotedKnight, pos.stm())
-                             | pos.pieceBb(PieceTypes::kPromotedSilver, pos.stm());
+        void generateGolds(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto golds = (pos.pieceBb(PieceTypes::kGold, pos.stm())
+                                | pos.pieceBb(PieceTypes::kPromotedPawn, pos.stm())
+                                | pos.pieceBb(PieceTypes::kPromotedLance, pos.stm())
+                                | pos.pieceBb(PieceTypes::kPromotedKnight, pos.stm())
+                                | pos.pieceBb(PieceTypes::kPromotedSilver, pos.stm()))
+                             & movable;
             generatePrecalculatedWithColor<false>(dst, pos, golds, attacks::goldAttacks, dstMask);
         }
 
         template <bool kGenerateUnlikelyMove>
-        void generateBishops(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto bishops = pos.pieceBb(PieceTypes::kBishop, pos.stm());
+        void generateBishops(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto bishops = pos.pieceBb(PieceTypes::kBishop, pos.stm()) & movable;
             generatePrecalculatedWithOcc<true, !kGenerateUnlikelyMove>(
                 dst,
                 pos,
@@ -231,26 +233,44 @@ namespace stoat::movegen {
         }
 
         template <bool kGenerateUnlikelyMove>
-        void generateRooks(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto rooks = pos.pieceBb(PieceTypes::kRook, pos.stm());
+        void generateRooks(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto rooks = pos.pieceBb(PieceTypes::kRook, pos.stm()) & movable;
             generatePrecalculatedWithOcc<true, !kGenerateUnlikelyMove>(dst, pos, rooks, attacks::rookAttacks, dstMask);
         }
 
-        void generatePromotedBishops(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto horses = pos.pieceBb(PieceTypes::kPromotedBishop, pos.stm());
+        void generatePromotedBishops(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto horses = pos.pieceBb(PieceTypes::kPromotedBishop, pos.stm()) & movable;
             generatePrecalculatedWithOcc<false>(dst, pos, horses, attacks::promotedBishopAttacks, dstMask);
         }
 
-        void generatePromotedRooks(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto dragons = pos.pieceBb(PieceTypes::kPromotedRook, pos.stm());
+        void generatePromotedRooks(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            const auto dragons = pos.pieceBb(PieceTypes::kPromotedRook, pos.stm()) & movable;
             generatePrecalculatedWithOcc<false>(dst, pos, dragons, attacks::promotedRookAttacks, dstMask);
         }
 
+        template <bool kLegal>
         void generateKings(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            const auto kings = pos.pieceBb(PieceTypes::kKing, pos.stm());
-            generatePrecalculated<false>(dst, pos, kings, attacks::kingAttacks, dstMask);
+            if constexpr (kLegal) {
+                const auto king = pos.kingSq(pos.stm());
+                const auto nstm = pos.stm().flip();
+
+                // remove the king, so that squares behind it on a checker's line count as attacked
+                const auto kinglessOcc = pos.occupancy() ^ Bitboard::fromSquare(king);
+
+                auto targets = attacks::kingAttacks(king) & dstMask;
+                while (!targets.empty()) {
+                    const auto to = targets.popLsb();
+                    if (!pos.isAttacked(to, nstm, kinglessOcc)) {
+                        dst.push(Move::makeNormal(king, to));
+                    }
+                }
+            } else {
+                const auto kings = pos.pieceBb(PieceTypes::kKing, pos.stm());
+                generatePrecalculated<false>(dst, pos, kings, attacks::kingAttacks, dstMask);
+            }
         }
 
+        template <bool kLegal>
         void generateDrops(MoveList& dst, const Position& pos, Bitboard dstMask) {
             if (dstMask.empty()) {
                 return;
@@ -265,7 +285,19 @@ namespace stoat::movegen {
 
             const auto generate = [&](PieceType pt, Bitboard restriction = Bitboards::kAll) {
                 if (hand.count(pt) > 0) {
-                    const auto targets = dstMask & restriction;
+                    auto targets = dstMask & restriction;
+
+                    // only pawn drops directly in front of the enemy king can be mate
+                    if constexpr (kLegal) {
+                        if (pt == PieceTypes::kPawn) {
+                            const auto checkSq =
+                                pos.pieceBb(PieceTypes::kKing, stm.flip()).shiftSouthRelative(stm) & targets;
+                            if (!checkSq.empty() && pos.isDropPawnMate(checkSq.lsb())) {
+                                targets ^= checkSq;
+                            }
+                        }
+                    }
+
                     serializeDrops(dst, pt, targets);
                 }
             };
@@ -282,9 +314,24 @@ namespace stoat::movegen {
             generate(PieceTypes::kRook);
         }
 
-        template <bool kGenerateDrops, bool kGenerateUnlikelyMoves>
+        template <bool kGenerateUnlikelyMoves>
+        void generatePieces(MoveList& dst, const Position& pos, Bitboard movable, Bitboard dstMask) {
+            generatePawns<kGenerateUnlikelyMoves>(dst, pos, movable, dstMask);
+            generateLances<kGenerateUnlikelyMoves>(dst, pos, movable, dstMask);
+            generateKnights(dst, pos, movable, dstMask);
+            generateSilvers(dst, pos, movable, dstMask);
+            generateGolds(dst, pos, movable, dstMask);
+            generateBishops<kGenerateUnlikelyMoves>(dst, pos, movable, dstMask);
+            generateRooks<kGenerateUnlikelyMoves>(dst, pos, movable, dstMask);
+            generatePromotedBishops(dst, pos, movable, dstMask);
+            generatePromotedRooks(dst, pos, movable, dstMask);
+        }
+
+        // kLegal additionally restricts king moves to unattacked squares, pinned pieces
+        // to their pin rays, and removes pawn drops that would deliver mate
+        template <bool kGenerateDrops, bool kGenerateUnlikelyMoves, bool kLegal>
         void generate(MoveList& dst, const Position& pos, Bitboard dstMask) {
-            generateKings(dst, pos, dstMask);
+            generateKings<kLegal>(dst, pos, dstMask);
 
             if (pos.checkers().multiple()) {
                 return;
@@ -300,51 +347,75 @@ namespace stoat::movegen {
                 dropMask &= checkRay;
             }
 
-            generatePawns<kGenerateUnlikelyMoves>(dst, pos, dstMask);
-            generateLances<kGenerateUnlikelyMoves>(dst, pos, dstMask);
-            generateKnights(dst, pos, dstMask);
-            generateSilvers(dst, pos, dstMask);
-            generateGolds(dst, pos, dstMask);
-            generateBishops<kGenerateUnlikelyMoves>(dst, pos, dstMask);
-            generateRooks<kGenerateUnlikelyMoves>(dst, pos, dstMask);
-            generatePromotedBishops(dst, pos, dstMask);
-            generatePromotedRooks(dst, pos, dstMask);
+            if constexpr (kLegal) {
+                const auto king = pos.kingSq(pos.stm());
+                const auto pinned = pos.pinned(pos.stm());
+
+                generatePieces<kGenerateUnlikelyMoves>(dst, pos, ~pinned, dstMask);
+
+                auto remaining = pinned;
+                while (!remaining.empty()) {
+                    const auto sq = remaining.popLsb();
+                    generatePieces<kGenerateUnlikelyMoves>(
+                        dst,
+                        pos,
+                        Bitboard::fromSquare(sq),
+                        dstMask & rayIntersecting(sq, king)
+                    );
+                }
+            } else {
+                generatePieces<kGenerateUnlikelyMoves>(dst, pos, Bitboards::kAll, dstMask);
+            }
 
             if constexpr (kGenerateDrops) {
-                generateDrops(dst, pos, dropMask);
+                generateDrops<kLegal>(dst, pos, dropMask);
             }
         }
     } // namespace
 
     template <bool kGenerateUnlikelyMoves>
     void generateAll(MoveList& dst, const Position& pos) {
+        const perf::ScopedPhase phase{perf::Phase::kMovegen};
+        const auto dstMask = ~pos.colorBb(pos.stm());
+        generate<true, kGenerateUnlikelyMoves, false>(dst, pos, dstMask);
+    }
+
+    template <bool kGenerateUnlikelyMoves>
+    void generateLegal(MoveList& dst, const Position& pos) {
+        const perf::ScopedPhase phase{perf::Phase::kMovegen};
         const auto dstMask = ~pos.colorBb(pos.stm());
-        generate<true, kGenerateUnlikelyMoves>(dst, pos, dstMask);
+        generate<true, kGenerateUnlikelyMoves, true>(dst, pos, dstMask);
     }
 
     template <bool kGenerateUnlikelyMoves>
     void generateCaptures(MoveList& dst, const Position& pos) {
+        const perf::ScopedPhase phase{perf::Phase::kMovegen};
         const auto dstMask = pos.colorBb(pos.stm().flip());
-        generate<false, kGenerateUnlikelyMoves>(dst, pos, dstMask);
+        generate<false, kGenerateUnlikelyMoves, true>(dst, pos, dstMask);
     }
 
     template <bool kGenerateUnlikelyMoves>
     void generateNonCaptures(MoveList& dst, const Position& pos) {
+        const perf::ScopedPhase phase{perf::Phase::kMovegen};
         const auto dstMask = ~pos.occupancy();
-        generate<true, kGenerateUnlikelyMoves>(dst, pos, dstMask);
+        generate<true, kGenerateUnlikelyMoves, true>(dst, pos, dstMask);
     }
 
     template <bool kGenerateUnlikelyMoves>
     void generateRecaptures(MoveList& dst, const Position& pos, Square captureSq) {
+        const perf::ScopedPhase phase{perf::Phase::kMovegen};
+
         assert(!pos.colorBb(pos.stm()).getSquare(captureSq));
         assert(pos.colorBb(pos.stm().flip()).getSquare(captureSq));
 
         const auto dstMask = Bitboard::fromSquare(captureSq);
-        generate<false, kGenerateUnlikelyMoves>(dst, pos, dstMask);
+        generate<false, kGenerateUnlikelyMoves, true>(dst, pos, dstMask);
     }
 
     template void generateAll<true>(MoveList&, const Position&);
     template void generateAll<false>(MoveList&, const Position&);
+    template void generateLegal<true>(MoveList&, const Position&);
+    template void generateLegal<false>(MoveList&, const Position&);
     template void generateCaptures<true>(MoveList&, const Position&);
     template void generateCaptures<false>(MoveList&, const Position&);
     template void generateNonCaptures<true>(MoveList&, const Position&);
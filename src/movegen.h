@@ -28,9 +28,15 @@ namespace stoat::movegen {
     constexpr usize kMoveListCapacity = 600;
     using MoveList = util::StaticVector<Move, kMoveListCapacity>;
 
+    // pseudolegal - moves may still need to be checked with Position::isLegal
     template <bool kGenerateUnlikelyMoves>
     void generateAll(MoveList& dst, const Position& pos);
 
+    // the remaining generators only produce legal moves
+
+    template <bool kGenerateUnlikelyMoves>
+    void generateLegal(MoveList& dst, const Position& pos);
+
     template <bool kGenerateUnlikelyMoves>
     void generateCaptures(MoveList& dst, const Position& pos);
 
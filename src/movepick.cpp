@@ -18,6 +18,7 @@
 
 #include "movepick.h"
 
+#include "perf_counters.h"
 #include "see.h"
 
 namespace stoat {
@@ -26,7 +27,7 @@ namespace stoat {
             case MovegenStage::kTtMove: {
                 ++m_stage;
 
-                if (m_ttMove && m_pos.isPseudolegal(m_ttMove)) {
+                if (m_ttMove && m_pos.isPseudolegal(m_ttMove) && m_pos.isLegal(m_ttMove)) {
                     return m_ttMove;
                 }
 
@@ -237,6 +238,8 @@ namespace stoat {
     }
 
     void MoveGenerator::scoreCaptures() {
+        const perf::ScopedPhase phase{perf::Phase::kMovepick};
+
         for (usize idx = m_idx; idx < m_end; ++idx) {
             m_scores[idx] = scoreCapture(m_moves[idx]);
         }
@@ -247,6 +250,8 @@ namespace stoat {
     }
 
     void MoveGenerator::scoreNonCaptures() {
+        const perf::ScopedPhase phase{perf::Phase::kMovepick};
+
         for (usize idx = m_idx; idx < m_end; ++idx) {
             m_scores[idx] = scoreNonCapture(m_moves[idx]);
         }
@@ -0,0 +1,371 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "perf_counters.h"
+
+#ifdef ST_PERF_COUNTERS
+
+    #ifndef __linux__
+        #error perf counters are only supported on Linux
+    #endif
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cerrno>
+    #include <cstring>
+    #include <mutex>
+    #include <string_view>
+    #include <vector>
+
+    #include <linux/perf_event.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <x86intrin.h>
+
+    #include "arch.h"
+    #include "util/multi_array.h"
+
+namespace stoat::perf {
+    namespace {
+        struct EventInfo {
+            std::string_view name;
+            u32 type;
+            u64 config;
+        };
+
+        constexpr u64 cacheEvent(u64 cache, u64 op, u64 result) {
+            return cache | (op << 8) | (result << 16);
+        }
+
+        constexpr std::array<EventInfo, kEventCount> kEvents = {{
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"L1D miss",
+             PERF_TYPE_HW_CACHE,
+             cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"LLC miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"br miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"dTLB miss",
+             PERF_TYPE_HW_CACHE,
+             cacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        }};
+
+        constexpr std::array<std::string_view, kPhaseCount> kPhaseNames = {
+            "search",
+            "movegen",
+            "movepick scoring",
+            "nnue update",
+            "nnue forward",
+            "tt probe",
+            "see",
+        };
+
+        // Only ever written by the thread that owns them, so that phase exits do not fight over
+        // shared cache lines and distort the very counts being measured. Atomic only so that
+        // print() and reset() can touch them from another thread while the owner is idle
+        struct alignas(kCacheLineSize) PhaseTotals {
+            util::MultiArray<std::atomic<u64>, kPhaseCount, kEventCount> events{};
+            std::array<std::atomic<u64>, kPhaseCount> calls{};
+
+            // no other thread writes, so this needs no locked read-modify-write
+            static inline void add(std::atomic<u64>& total, u64 v) {
+                total.store(total.load(std::memory_order::relaxed) + v, std::memory_order::relaxed);
+            }
+
+            void addTo(PhaseTotals& dst) const {
+                for (usize phaseIdx = 0; phaseIdx < kPhaseCount; ++phaseIdx) {
+                    for (usize i = 0; i < kEventCount; ++i) {
+                        add(dst.events[phaseIdx][i], events[phaseIdx][i].load(std::memory_order::relaxed));
+                    }
+
+                    add(dst.calls[phaseIdx], calls[phaseIdx].load(std::memory_order::relaxed));
+                }
+            }
+
+            void clear() {
+                for (usize phaseIdx = 0; phaseIdx < kPhaseCount; ++phaseIdx) {
+                    for (auto& total : events[phaseIdx]) {
+                        total.store(0, std::memory_order::relaxed);
+                    }
+
+                    calls[phaseIdx].store(0, std::memory_order::relaxed);
+                }
+            }
+        };
+
+        // guards the list of live threads' totals, and the totals of threads that have exited
+        std::mutex s_totalsMutex{};
+        std::vector<PhaseTotals*> s_threadTotals{};
+        PhaseTotals s_exitedTotals{};
+
+        std::atomic_bool s_failed{false};
+
+        class RegisteredTotals {
+        public:
+            RegisteredTotals() {
+                const std::scoped_lock lock{s_totalsMutex};
+                s_threadTotals.push_back(&m_totals);
+            }
+
+            ~RegisteredTotals() {
+                const std::scoped_lock lock{s_totalsMutex};
+
+                m_totals.addTo(s_exitedTotals);
+                std::erase(s_threadTotals, &m_totals);
+            }
+
+            [[nodiscard]] inline PhaseTotals& totals() {
+                return m_totals;
+            }
+
+        private:
+            PhaseTotals m_totals{};
+        };
+
+        [[nodiscard]] PhaseTotals& threadTotals() {
+            thread_local RegisteredTotals s_totals{};
+            return s_totals.totals();
+        }
+
+        class ThreadCounters {
+        public:
+            ThreadCounters() {
+                i32 leader = -1;
+
+                for (usize i = 0; i < kEventCount; ++i) {
+                    perf_event_attr attr{};
+
+                    attr.size = sizeof(perf_event_attr);
+                    attr.type = kEvents[i].type;
+                    attr.config = kEvents[i].config;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+
+                    const auto fd = static_cast<i32>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+
+                    if (fd < 0) {
+                        if (!s_failed.exchange(true)) {
+                            fmt::println(
+                                stderr,
+                                "failed to open perf counter '{}': {}",
+                                kEvents[i].name,
+                                std::strerror(errno)
+                            );
+                        }
+
+                        close();
+                        return;
+                    }
+
+                    if (leader < 0) {
+                        leader = fd;
+                    }
+
+                    auto& counter = m_counters[i];
+                    counter.fd = fd;
+
+                    // fall back to read() if the page cannot be mapped
+                    auto* page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+                    if (page != MAP_FAILED) {
+                        counter.page = static_cast<const volatile perf_event_mmap_page*>(page);
+                    }
+                }
+
+                m_valid = true;
+            }
+
+            ~ThreadCounters() {
+                close();
+            }
+
+            [[nodiscard]] inline bool valid() const {
+                return m_valid;
+            }
+
+            inline void read(std::array<u64, kEventCount>& dst) const {
+                for (usize i = 0; i < kEventCount; ++i) {
+                    dst[i] = readCounter(m_counters[i]);
+                }
+            }
+
+        private:
+            struct Counter {
+                i32 fd{-1};
+                const volatile perf_event_mmap_page* page{};
+            };
+
+            std::array<Counter, kEventCount> m_counters{};
+            bool m_valid{};
+
+            void close() {
+                for (auto& counter : m_counters) {
+                    if (counter.page) {
+                        munmap(const_cast<perf_event_mmap_page*>(counter.page), sysconf(_SC_PAGESIZE));
+                    }
+
+                    if (counter.fd >= 0) {
+                        ::close(counter.fd);
+                    }
+
+                    counter = {};
+                }
+
+                m_valid = false;
+            }
+
+            [[nodiscard]] static u64 readCounter(const Counter& counter) {
+                const auto* page = counter.page;
+
+                if (page && page->cap_user_rdpmc) {
+                    u32 seq;
+                    u64 count;
+
+                    // seqlock protocol from linux/perf_event.h
+                    do {
+                        seq = page->lock;
+                        std::atomic_signal_fence(std::memory_order::seq_cst);
+
+                        const auto idx = page->index;
+                        count = page->offset;
+
+                        // idx is 0 while the counter is not scheduled
+                        if (idx != 0) {
+                            const auto shift = 64 - page->pmc_width;
+
+                            auto pmc = static_cast<i64>(__rdpmc(static_cast<i32>(idx - 1)));
+                            pmc = static_cast<i64>(static_cast<u64>(pmc) << shift) >> shift;
+
+                            count += static_cast<u64>(pmc);
+                        }
+
+                        std::atomic_signal_fence(std::memory_order::seq_cst);
+                    } while (page->lock != seq);
+
+                    return count;
+                }
+
+                u64 count{};
+
+                if (::read(counter.fd, &count, sizeof(count)) != sizeof(count)) {
+                    return 0;
+                }
+
+                return count;
+            }
+        };
+
+        [[nodiscard]] const ThreadCounters& threadCounters() {
+            thread_local const ThreadCounters s_counters{};
+            return s_counters;
+        }
+    } // namespace
+
+    ScopedPhase::ScopedPhase(Phase phase) :
+            m_phase{phase} {
+        const auto& counters = threadCounters();
+
+        if (!counters.valid()) {
+            return;
+        }
+
+        m_active = true;
+        counters.read(m_start);
+    }
+
+    ScopedPhase::~ScopedPhase() {
+        if (!m_active) {
+            return;
+        }
+
+        std::array<u64, kEventCount> end;
+        threadCounters().read(end);
+
+        const auto phaseIdx = static_cast<usize>(m_phase);
+        auto& totals = threadTotals();
+
+        for (usize i = 0; i < kEventCount; ++i) {
+            PhaseTotals::add(totals.events[phaseIdx][i], end[i] - m_start[i]);
+        }
+
+        PhaseTotals::add(totals.calls[phaseIdx], 1);
+    }
+
+    void reset() {
+        const std::scoped_lock lock{s_totalsMutex};
+
+        for (auto* totals : s_threadTotals) {
+            totals->clear();
+        }
+
+        s_exitedTotals.clear();
+    }
+
+    void print(usize nodes) {
+        if (s_failed.load() || nodes == 0) {
+            return;
+        }
+
+        PhaseTotals merged{};
+
+        {
+            const std::scoped_lock lock{s_totalsMutex};
+
+            for (const auto* totals : s_threadTotals) {
+                totals->addTo(merged);
+            }
+
+            s_exitedTotals.addTo(merged);
+        }
+
+        const auto perNode = [&](u64 v) { return static_cast<f64>(v) / static_cast<f64>(nodes); };
+
+        fmt::println("");
+        fmt::println("perf counters per node ({} nodes, phases include nested phases):", nodes);
+
+        fmt::print("{:<17} {:>10}", "phase", "calls");
+        for (const auto& event : kEvents) {
+            fmt::print(" {:>10}", event.name);
+        }
+        fmt::println(" {:>6}", "IPC");
+
+        for (usize phaseIdx = 0; phaseIdx < kPhaseCount; ++phaseIdx) {
+            const auto calls = merged.calls[phaseIdx].load();
+
+            if (calls == 0) {
+                continue;
+            }
+
+            fmt::print("{:<17} {:>10.3f}", kPhaseNames[phaseIdx], perNode(calls));
+
+            for (usize i = 0; i < kEventCount; ++i) {
+                fmt::print(" {:>10.2f}", perNode(merged.events[phaseIdx][i].load()));
+            }
+
+            const auto cycles = merged.events[phaseIdx][0].load();
+            const auto instructions = merged.events[phaseIdx][1].load();
+
+            fmt::println(
+                " {:>6.2f}",
+                cycles > 0 ? static_cast<f64>(instructions) / static_cast<f64>(cycles) : 0.0
+            );
+        }
+    }
+} // namespace stoat::perf
+
+#endif
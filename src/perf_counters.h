@@ -0,0 +1,72 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <array>
+
+// Optional hardware performance counter instrumentation, enabled by building with
+// ST_PERF_COUNTERS defined (Linux only). Counters are opened per thread on first use,
+// and read with rdpmc where the kernel allows it. Totals are also kept per thread, and
+// only merged when printed. Phases may nest, and each phase's counts include anything
+// nested inside it. Compiles to nothing when disabled
+
+namespace stoat::perf {
+    enum class Phase : u32 {
+        kSearch = 0,
+        kMovegen,
+        kMovepick,
+        kNnueUpdate,
+        kNnueForward,
+        kTtProbe,
+        kSee,
+        kCount,
+    };
+
+    constexpr usize kPhaseCount = static_cast<usize>(Phase::kCount);
+    constexpr usize kEventCount = 6;
+
+#ifdef ST_PERF_COUNTERS
+    class ScopedPhase {
+    public:
+        explicit ScopedPhase(Phase phase);
+        ~ScopedPhase();
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase(ScopedPhase&&) = delete;
+
+    private:
+        Phase m_phase;
+        bool m_active{};
+        std::array<u64, kEventCount> m_start{};
+    };
+
+    void reset();
+    void print(usize nodes);
+#else
+    class ScopedPhase {
+    public:
+        explicit constexpr ScopedPhase([[maybe_unused]] Phase phase) {}
+    };
+
+    inline void reset() {}
+    inline void print([[maybe_unused]] usize nodes) {}
+#endif
+} // namespace stoat::perf
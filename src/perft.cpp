@@ -18,66 +18,229 @@
 
 #include "perft.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "movegen.h"
 #include "util/timer.h"
 
 namespace stoat {
     namespace {
-        usize doPerft(const Position& pos, i32 depth) {
+        // Lockless perft cache. Each entry stores the node count packed together with
+        // the remaining depth, and the key xored with that data, so a torn write from
+        // another thread simply fails the key check instead of returning a bogus count
+        class PerftTable {
+        public:
+            explicit PerftTable(usize mib) {
+                const auto entries = mib * 1024 * 1024 / sizeof(Entry);
+
+                if (entries > 0) {
+                    m_entries = std::make_unique<Entry[]>(entries);
+                    m_entryCount = entries;
+                }
+            }
+
+            [[nodiscard]] inline bool enabled() const {
+                return m_entryCount > 0;
+            }
+
+            [[nodiscard]] inline bool probe(usize& dst, u64 key, i32 depth) const {
+                assert(enabled());
+
+                const auto& entry = m_entries[index(key)];
+
+                const auto data = entry.data.load(std::memory_order::relaxed);
+                const auto storedKey = entry.key.load(std::memory_order::relaxed);
+
+                if ((storedKey ^ data) != key || (data & kDepthMask) != static_cast<u64>(depth)) {
+                    return false;
+                }
+
+                dst = static_cast<usize>(data >> kDepthBits);
+                return true;
+            }
+
+            inline void put(u64 key, i32 depth, usize nodes) {
+                assert(enabled());
+                assert(depth > 0 && depth <= static_cast<i32>(kDepthMask));
+
+                // counts that do not fit after packing are not worth caching anyway
+                if (nodes >= (u64{1} << (64 - kDepthBits))) {
+                    return;
+                }
+
+                auto& entry = m_entries[index(key)];
+
+                const auto data = (static_cast<u64>(nodes) << kDepthBits) | static_cast<u64>(depth);
+
+                entry.key.store(key ^ data, std::memory_order::relaxed);
+                entry.data.store(data, std::memory_order::relaxed);
+            }
+
+        private:
+            static constexpr u32 kDepthBits = 8;
+            static constexpr u64 kDepthMask = (u64{1} << kDepthBits) - 1;
+
+            struct Entry {
+                std::atomic<u64> key{};
+                std::atomic<u64> data{};
+            };
+
+            std::unique_ptr<Entry[]> m_entries{};
+            usize m_entryCount{};
+
+            [[nodiscard]] constexpr usize index(u64 key) const {
+                return static_cast<usize>((static_cast<u128>(key) * static_cast<u128>(m_entryCount)) >> 64);
+            }
+        };
+
+        usize doPerft(const Position& pos, i32 depth, PerftTable& table) {
             if (depth <= 0) {
                 return 1;
             }
 
             movegen::MoveList moves{};
-            movegen::generateAll<true>(moves, pos);
+            movegen::generateLegal<true>(moves, pos);
+
+            // bulk count - no need to make the moves at the last ply
+            if (depth == 1) {
+                return moves.size();
+            }
 
             usize total{};
 
+            if (table.enabled() && table.probe(total, pos.key(), depth)) {
+                return total;
+            }
+
             for (const auto move : moves) {
-                if (!pos.isLegal(move)) {
-                    continue;
-                }
+                const auto newPos = pos.applyMove(move);
+                total += doPerft(newPos, depth - 1, table);
+            }
 
-                if (depth == 1) {
-                    ++total;
-                } else {
-                    const auto newPos = pos.applyMove(move);
-                    total += doPerft(newPos, depth - 1);
-                }
+            if (table.enabled()) {
+                table.put(pos.key(), depth, total);
             }
 
             return total;
         }
+
+        struct RootMoveResult {
+            Move move;
+            usize nodes;
+        };
+
+        // Root moves are handed out to the threads one at a time, so
+        // uneven subtrees do not leave the other threads idle
+        std::vector<RootMoveResult> runPerft(const Position& pos, i32 depth, const PerftOptions& options) {
+            assert(depth >= 1);
+
+            movegen::MoveList moves{};
+            movegen::generateLegal<true>(moves, pos);
+
+            std::vector<RootMoveResult> results{};
+            results.reserve(moves.size());
+
+            for (const auto move : moves) {
+                results.push_back({move, 0});
+            }
+
+            PerftTable table{kPerftHashRange.clamp(options.hashMib)};
+
+            const auto threadCount =
+                std::min<usize>(kPerftThreadRange.clamp(options.threads), std::max<usize>(results.size(), 1));
+
+            std::atomic<usize> nextMove{0};
+
+            const auto worker = [&] {
+                while (true) {
+                    const auto idx = nextMove.fetch_add(1, std::memory_order::relaxed);
+
+                    if (idx >= results.size()) {
+                        break;
+                    }
+
+                    auto& result = results[idx];
+
+                    const auto newPos = pos.applyMove(result.move);
+                    result.nodes = doPerft(newPos, depth - 1, table);
+                }
+            };
+
+            std::vector<std::thread> threads{};
+            threads.reserve(threadCount - 1);
+
+            for (usize i = 1; i < threadCount; ++i) {
+                threads.emplace_back(worker);
+            }
+
+            worker();
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            return results;
+        }
+
+        void printPerftResult(usize total, f64 time) {
+            const auto nps = static_cast<usize>(static_cast<f64>(total) / std::max(time, 0.000001));
+
+            fmt::println("total: {}", total);
+            fmt::println("{} nps", nps);
+        }
     } // namespace
 
-    void splitPerft(const Position& pos, i32 depth) {
+    usize perftNodes(const Position& pos, i32 depth, const PerftOptions& options) {
+        if (depth <= 0) {
+            return 1;
+        }
+
+        const auto results = runPerft(pos, depth, options);
+
+        usize total{};
+
+        for (const auto& result : results) {
+            total += result.nodes;
+        }
+
+        return total;
+    }
+
+    void perft(const Position& pos, i32 depth, const PerftOptions& options) {
         if (depth < 1) {
             depth = 1;
         }
 
         const auto start = util::Instant::now();
+        const auto total = perftNodes(pos, depth, options);
 
-        movegen::MoveList moves{};
-        movegen::generateAll<true>(moves, pos);
+        printPerftResult(total, start.elapsed());
+    }
 
-        usize total{};
+    void splitPerft(const Position& pos, i32 depth, const PerftOptions& options) {
+        if (depth < 1) {
+            depth = 1;
+        }
 
-        for (const auto move : moves) {
-            if (!pos.isLegal(move)) {
-                continue;
-            }
+        const auto start = util::Instant::now();
 
-            const auto newPos = pos.applyMove(move);
-            const auto value = doPerft(newPos, depth - 1);
+        const auto results = runPerft(pos, depth, options);
 
-            total += value;
-            fmt::println("{}\t{}", move, value);
-        }
+        const auto time = start.elapsed();
+
+        usize total{};
 
-        const auto nps = static_cast<usize>(static_cast<f64>(total) / start.elapsed());
+        for (const auto& [move, nodes] : results) {
+            total += nodes;
+            fmt::println("{}\t{}", move, nodes);
+        }
 
         fmt::println("");
-        fmt::println("total: {}", total);
-        fmt::println("{} nps", nps);
+        printPerftResult(total, time);
     }
 } // namespace stoat
@@ -21,7 +21,23 @@
 #include "types.h"
 
 #include "position.h"
+#include "util/range.h"
 
 namespace stoat {
-    void splitPerft(const Position& pos, i32 depth);
-}
+    constexpr u32 kDefaultPerftThreads = 1;
+    constexpr util::Range<u32> kPerftThreadRange{1, 2048};
+
+    // 0 disables the perft cache
+    constexpr usize kDefaultPerftHashMib = 0;
+    constexpr util::Range<usize> kPerftHashRange{0, 131072};
+
+    struct PerftOptions {
+        u32 threads{kDefaultPerftThreads};
+        usize hashMib{kDefaultPerftHashMib};
+    };
+
+    [[nodiscard]] usize perftNodes(const Position& pos, i32 depth, const PerftOptions& options = {});
+
+    void perft(const Position& pos, i32 depth, const PerftOptions& options = {});
+    void splitPerft(const Position& pos, i32 depth, const PerftOptions& options = {});
+} // namespace stoat
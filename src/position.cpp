@@ -20,12 +20,14 @@
 
 #include <algorithm>
 #include <iterator>
+#include <utility>
 
 #include "attacks/attacks.h"
+#include "cuckoo.h"
 #include "eval/nnue.h"
 #include "keys.h"
-#include "movegen.h"
 #include "rays.h"
+#include "repetition.h"
 #include "util/parse.h"
 #include "util/split.h"
 
@@ -68,6 +70,248 @@ namespace stoat {
             ((1 << kRookHandBits) - 1) << kRookHandOffset,
             ((1 << kGoldHandBits) - 1) << kGoldHandOffset,
         };
+
+        // PackedSfen layout: side to move (1 bit), black and white king squares
+        // (7 bits each), then every non-king square as a Huffman code followed
+        // by a promotion bit (except gold) and a colour bit, then hand pieces
+        // until all 256 bits are used
+        constexpr u32 kPackedSfenBits = 256;
+
+        struct PackedCode {
+            u8 code;
+            u8 bits;
+        };
+
+        constexpr PackedCode kPackedEmptySquare{0b0, 1};
+
+        // indexed by hand piece type
+        constexpr std::array<PackedCode, kHandPieces.size()> kPackedBoardCodes{{
+            {0b1, 2},
+            {0b0011, 4},
+            {0b1011, 4},
+            {0b0111, 4},
+            {0b011111, 6},
+            {0b111111, 6},
+            {0b01111, 5},
+        }};
+
+        // the full set of each hand piece type, promoted or not
+        constexpr std::array kPackedPieceCounts = {18, 4, 4, 4, 2, 2, 4};
+
+        constexpr auto kPackedSquares = [] {
+            std::array<Square, Squares::kCount> squares{};
+
+            for (i32 idx = 0; idx < Squares::kCount; ++idx) {
+                squares[idx] = Square::fromFileRank(8 - idx / 9, 8 - idx % 9);
+                assert(PackedSfen::squareIdx(squares[idx]) == idx);
+            }
+
+            return squares;
+        }();
+
+        // full codes including the promotion and colour bits, indexed by raw piece.
+        // kings (and promoted pieces in hand) are left with a width of 0
+        template <bool kHand>
+        constexpr auto packedPieceCodes() {
+            std::array<std::pair<u32, u32>, Pieces::kNone.raw() + 1> codes{};
+
+            if constexpr (!kHand) {
+                codes[Pieces::kNone.raw()] = {kPackedEmptySquare.code, kPackedEmptySquare.bits};
+            }
+
+            for (u8 raw = 0; raw < Pieces::kNone.raw(); ++raw) {
+                const auto piece = Piece::fromRaw(raw);
+                const auto type = piece.type().unpromoted();
+
+                if (type == PieceTypes::kKing || (kHand && piece.isPromoted())) {
+                    continue;
+                }
+
+                auto [code, bits] = kPackedBoardCodes[type.idx()];
+
+                // hand codes drop the leading empty-square bit
+                u32 value = kHand ? code >> 1 : code;
+                u32 width = kHand ? bits - 1 : bits;
+
+                if (type != PieceTypes::kGold) {
+                    value |= static_cast<u32>(piece.isPromoted()) << width;
+                    ++width;
+                }
+
+                value |= piece.color().raw() << width;
+                ++width;
+
+                codes[raw] = {value, width};
+            }
+
+            return codes;
+        }
+
+        template <bool kHand>
+        constexpr auto kPackedPieceCodes = packedPieceCodes<kHand>();
+
+        constexpr u32 kPackedPeekBits = 8;
+
+        // indexed by the next 8 bits of the stream. Hand patterns
+        // with no matching piece (promoted pieces) decode to no piece
+        // and a width of 0
+        template <bool kHand>
+        constexpr auto kPackedDecodeTable = [] {
+            constexpr auto kCodes = packedPieceCodes<kHand>();
+
+            std::array<std::pair<Piece, u32>, 1 << kPackedPeekBits> table{};
+
+            for (u32 bits = 0; bits < table.size(); ++bits) {
+                table[bits] = {Pieces::kNone, 0};
+
+                for (u8 raw = 0; raw <= Pieces::kNone.raw(); ++raw) {
+                    const auto [code, width] = kCodes[raw];
+
+                    if (width > 0 && (bits & ((1 << width) - 1)) == code) {
+                        table[bits] = {Piece::fromRaw(raw), width};
+                        break;
+                    }
+                }
+            }
+
+            return table;
+        }();
+
+        // buffers bits in a register rather than read-modify-writing
+        // the output, which would serialise every write on a store
+        class PackedSfenWriter {
+        public:
+            inline void write(u32 value, u32 bits) {
+                assert(bits < 32);
+
+                m_buffer |= static_cast<u64>(value) << m_bufferedBits;
+                m_bufferedBits += bits;
+
+                if (m_bufferedBits >= 64) {
+                    assert(m_word < m_words.size());
+
+                    m_words[m_word++] = m_buffer;
+                    m_bufferedBits -= 64;
+
+                    // bits of this value that did not fit
+                    m_buffer = static_cast<u64>(value) >> (bits - m_bufferedBits);
+                }
+            }
+
+            [[nodiscard]] inline PackedSfen finish() const {
+                assert(m_word == m_words.size());
+                assert(m_bufferedBits == 0);
+
+                PackedSfen packed{};
+
+                for (usize i = 0; i < packed.data.size(); ++i) {
+                    packed.data[i] = static_cast<u8>(m_words[i / 8] >> (i % 8 * 8));
+                }
+
+                return packed;
+            }
+
+        private:
+            std::array<u64, kPackedSfenBits / 64> m_words{};
+            u32 m_word{};
+
+            u64 m_buffer{};
+            u32 m_bufferedBits{};
+        };
+
+        // bits past the end of the stream read as zero
+        class PackedSfenReader {
+        public:
+            explicit PackedSfenReader(const PackedSfen& packed) {
+                std::ranges::copy(packed.data, m_bytes.begin());
+                refill();
+            }
+
+            [[nodiscard]] inline u32 peek() const {
+                return static_cast<u32>(m_buffer) & ((1 << kPackedPeekBits) - 1);
+            }
+
+            inline void skip(u32 bits) {
+                assert(bits <= kPackedPeekBits);
+
+                m_buffer >>= bits;
+                m_bufferedBits -= bits;
+                m_cursor += bits;
+
+                if (m_bufferedBits < kPackedPeekBits) {
+                    refill();
+                }
+            }
+
+            [[nodiscard]] inline u32 read(u32 bits) {
+                const auto value = peek() & ((1 << bits) - 1);
+                skip(bits);
+                return value;
+            }
+
+            [[nodiscard]] inline u32 cursor() const {
+                return m_cursor;
+            }
+
+        private:
+            // the padding bytes let a full word be loaded from any byte in the stream
+            std::array<u8, sizeof(PackedSfen::data) + sizeof(u64)> m_bytes{};
+            u32 m_cursor{};
+
+            u64 m_buffer{};
+            u32 m_bufferedBits{};
+
+            inline void refill() {
+                if (m_cursor >= kPackedSfenBits) {
+                    m_buffer = 0;
+                    m_bufferedBits = 64;
+                    return;
+                }
+
+                const auto byte = m_cursor / 8;
+
+                m_buffer = 0;
+
+                for (usize i = 0; i < sizeof(u64); ++i) {
+                    m_buffer |= static_cast<u64>(m_bytes[byte + i]) << (i * 8);
+                }
+
+                m_buffer >>= m_cursor % 8;
+                m_bufferedBits = 64 - m_cursor % 8;
+            }
+        };
+
+        // which of the partial keys each piece type contributes to, as
+        // masks so that updating them does not branch on the piece type
+        struct PieceKeyMasks {
+            u64 castle;
+            u64 cavalry;
+            u64 hand;
+            u64 kpr;
+        };
+
+        constexpr auto kPieceKeyMasks = [] {
+            std::array<PieceKeyMasks, PieceTypes::kCount> masks{};
+
+            const auto mask = [](bool included) { return included ? ~u64{0} : u64{0}; };
+
+            for (const auto pt : PieceTypes::kAll) {
+                masks[pt.idx()] = {
+                    .castle = mask(pt == PieceTypes::kKing || pt == PieceTypes::kSilver || pt == PieceTypes::kGold),
+                    .cavalry = mask(
+                        pt == PieceTypes::kKnight || pt == PieceTypes::kBishop || pt == PieceTypes::kRook
+                        || pt == PieceTypes::kPromotedBishop || pt == PieceTypes::kPromotedRook
+                    ),
+                    .hand = mask(pt == PieceTypes::kKing),
+                    .kpr = mask(
+                        pt == PieceTypes::kKing || pt == PieceTypes::kPawn || pt == PieceTypes::kRook
+                        || pt == PieceTypes::kPromotedRook
+                    ),
+                };
+            }
+
+            return masks;
+        }();
     } // namespace
 
     u32 Hand::count(PieceType pt) const {
@@ -111,6 +355,11 @@ namespace stoat {
         m_hand = (m_hand & ~mask) | (count << offset);
     }
 
+    bool Hand::isSupersetOf(Hand other) const {
+        // every count sits in its own field, so comparing the masked fields compares the counts
+        return std::ranges::all_of(kHandMasks, [&](u32 mask) { return (m_hand & mask) >= (other.m_hand & mask); });
+    }
+
     Hand Hand::fromRaw(u32 raw) {
         return Hand{raw};
     }
@@ -160,28 +409,13 @@ namespace stoat {
         assert(sq);
 
         const auto key = keys::pieceSquare(piece, sq);
+        const auto& masks = kPieceKeyMasks[piece.type().idx()];
 
         all ^= key;
-
-        if (piece.type() == PieceTypes::kKing || piece.type() == PieceTypes::kSilver
-            || piece.type() == PieceTypes::kGold)
-        {
-            castle ^= key;
-        }
-        if (piece.type() == PieceTypes::kKnight || piece.type() == PieceTypes::kBishop
-            || piece.type() == PieceTypes::kRook || piece.type() == PieceTypes::kPromotedBishop
-            || piece.type() == PieceTypes::kPromotedRook)
-        {
-            cavalry ^= key;
-        }
-        if (piece.type() == PieceTypes::kKing) {
-            hand ^= key;
-        }
-        if (piece.type() == PieceTypes::kKing || piece.type() == PieceTypes::kPawn || piece.type() == PieceTypes::kRook
-            || piece.type() == PieceTypes::kPromotedRook)
-        {
-            kpr ^= key;
-        }
+        castle ^= key & masks.castle;
+        cavalry ^= key & masks.cavalry;
+        hand ^= key & masks.hand;
+        kpr ^= key & masks.kpr;
     }
 
     void PositionKeys::movePiece(Piece piece, Square from, Square to) {
@@ -190,28 +424,13 @@ namespace stoat {
         assert(to);
 
         const auto key = keys::pieceSquare(piece, from) ^ keys::pieceSquare(piece, to);
+        const auto& masks = kPieceKeyMasks[piece.type().idx()];
 
         all ^= key;
-
-        if (piece.type() == PieceTypes::kKing || piece.type() == PieceTypes::kSilver
-            || piece.type() == PieceTypes::kGold)
-        {
-            castle ^= key;
-        }
-        if (piece.type() == PieceTypes::kKnight || piece.type() == PieceTypes::kBishop
-            || piece.type() == PieceTypes::kRook || piece.type() == PieceTypes::kPromotedBishop
-            || piece.type() == PieceTypes::kPromotedRook)
-        {
-            cavalry ^= key;
-        }
-        if (piece.type() == PieceTypes::kKing) {
-            hand ^= key;
-        }
-        if (piece.type() == PieceTypes::kKing || piece.type() == PieceTypes::kPawn || piece.type() == PieceTypes::kRook
-            || piece.type() == PieceTypes::kPromotedRook)
-        {
-            kpr ^= key;
-        }
+        castle ^= key & masks.castle;
+        cavalry ^= key & masks.cavalry;
+        hand ^= key & masks.hand;
+        kpr ^= key & masks.kpr;
     }
 
     void PositionKeys::flipStm() {
@@ -311,11 +530,18 @@ namespace stoat {
         newPos.m_keys.flipStm();
 
         newPos.m_checkers = Bitboards::kEmpty;
-        newPos.updateSlidingCheckersAndPins();
+        // pins do not depend on the side to move, so they carry over unchanged
 
         return newPos;
     }
 
+    u64 Position::boardKey() const {
+        // the hand key also includes both kings
+        const auto handKey = m_keys.hand ^ keys::pieceSquare(Pieces::kBlackKing, kingSq(Colors::kBlack))
+                           ^ keys::pieceSquare(Pieces::kWhiteKing, kingSq(Colors::kWhite));
+        return m_keys.all ^ handKey;
+    }
+
     u64 Position::keyAfter(Move move) const {
         auto key = m_keys.all ^ keys::stm();
 
@@ -367,13 +593,7 @@ namespace stoat {
             if (keyHistory[i] == key()) {
                 --repetitions;
                 if (repetitions == 0) {
-                    // Older cutechess versions do not handle perpetuals
-                    // properly - work around that to avoid illegal moves
-                    if (cuteChessWorkaround) {
-                        return isInCheck() ? SennichiteStatus::kWin : SennichiteStatus::kDraw;
-                    } else {
-                        return m_consecutiveChecks[stm().idx()] >= 2 ? SennichiteStatus::kWin : SennichiteStatus::kDraw;
-                    }
+                    return exactRepetitionStatus(cuteChessWorkaround);
                 }
             }
         }
@@ -381,6 +601,75 @@ namespace stoat {
         return SennichiteStatus::kNone;
     }
 
+    SennichiteStatus Position::testSennichite(
+        bool cuteChessWorkaround,
+        const RepetitionTable& repetitions,
+        i32 limit
+    ) const {
+        switch (repetitions.find(*this, limit)) {
+            case RepetitionType::kExact:
+                return exactRepetitionStatus(cuteChessWorkaround);
+            case RepetitionType::kSuperior:
+                return SennichiteStatus::kSuperior;
+            case RepetitionType::kInferior:
+                return SennichiteStatus::kInferior;
+            default:
+                return SennichiteStatus::kNone;
+        }
+    }
+
+    SennichiteStatus Position::exactRepetitionStatus(bool cuteChessWorkaround) const {
+        // Older cutechess versions do not handle perpetuals
+        // properly - work around that to avoid illegal moves
+        if (cuteChessWorkaround) {
+            return isInCheck() ? SennichiteStatus::kWin : SennichiteStatus::kDraw;
+        } else {
+            return m_consecutiveChecks[stm().idx()] >= 2 ? SennichiteStatus::kWin : SennichiteStatus::kDraw;
+        }
+    }
+
+    bool Position::hasUpcomingRepetition(std::span<const u64> keyHistory, i32 limit) const {
+        const auto stm = this->stm();
+
+        // if the opponent is already being checked, a repetition reached
+        // by another check would be a perpetual rather than a draw
+        if (m_consecutiveChecks[stm.flip().idx()] > 0) {
+            return false;
+        }
+
+        const auto size = static_cast<i32>(keyHistory.size());
+        const auto end = std::max(0, size - limit);
+
+        const auto occ = occupancy();
+
+        // the earliest position this could repeat is 4 plies back from the child
+        for (i32 i = size - 3; i >= end; i -= 2) {
+            const auto* entry = cuckoo::find(key() ^ keyHistory[i]);
+
+            if (!entry || entry->piece.color() != stm) {
+                continue;
+            }
+
+            auto from = entry->a;
+            auto to = entry->b;
+
+            if (pieceOn(from) != entry->piece) {
+                std::swap(from, to);
+            }
+
+            if (pieceOn(from) != entry->piece || pieceOn(to)) {
+                continue;
+            }
+
+            // not all of these pieces can move in both directions
+            if (attacks::pieceAttacks(entry->piece.type(), from, stm, occ).getSquare(to)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     bool Position::isEnteringKingsWin() const {
         if (isInCheck()) {
             return false;
@@ -548,17 +837,7 @@ namespace stoat {
             if (move.dropPiece() == PieceTypes::kPawn) {
                 const auto dropBb = Bitboard::fromSquare(move.to());
                 if (!(dropBb.shiftNorthRelative(stm) & pieceBb(PieceTypes::kKing, nstm)).empty()) {
-                    // this pawn drop gives check - ensure it's not mate
-                    // slow and cursed, but rare
-                    const auto newPos = applyMove(move);
-
-                    assert(newPos.checkers().one());
-                    assert(newPos.checkers().getSquare(move.to()));
-
-                    movegen::MoveList newMoves{};
-                    movegen::generateAll<false>(newMoves, newPos);
-
-                    return std::ranges::any_of(newMoves, [&](Move newMove) { return newPos.isLegal(newMove); });
+                    return !isDropPawnMate(move.to());
                 }
             }
 
@@ -583,6 +862,41 @@ namespace stoat {
         return true;
     }
 
+    bool Position::isDropPawnMate(Square sq) const {
+        assert(sq);
+
+        const auto stm = this->stm();
+        const auto nstm = this->stm().flip();
+
+        const auto theirKing = kingSq(nstm);
+
+        assert(pieceOn(sq) == Pieces::kNone);
+        assert(attacks::pawnAttacks(sq, stm).getSquare(theirKing));
+
+        // The check is adjacent, so it cannot be blocked - the opponent
+        // can only capture the pawn or move their king out of the way
+        auto capturers = attackersTo(sq, nstm) & ~pieceBb(PieceTypes::kKing, nstm);
+        while (!capturers.empty()) {
+            const auto capturer = capturers.popLsb();
+            if (!pinned(nstm).getSquare(capturer) || rayIntersecting(capturer, theirKing).getSquare(sq)) {
+                return false;
+            }
+        }
+
+        // the pawn may block attacks on the king's flight squares, and the king cannot block attacks on them
+        const auto occ = (occupancy() | Bitboard::fromSquare(sq)) ^ Bitboard::fromSquare(theirKing);
+
+        auto flights = attacks::kingAttacks(theirKing) & ~colorBb(nstm);
+        while (!flights.empty()) {
+            const auto flight = flights.popLsb();
+            if (!isAttacked(flight, stm, occ)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     bool Position::isCapture(Move move) const {
         return pieceOn(move.to()) != Pieces::kNone;
     }
@@ -808,7 +1122,7 @@ namespace stoat {
         assert(sq);
         assert(piece);
 
-        assert(!pieceOn(sq));
+        assert(pieceOn(sq) == Pieces::kNone);
 
         m_colors[piece.color().idx()] |= sq.bit();
         m_pieces[piece.type().idx()] |= sq.bit();
@@ -937,7 +1251,7 @@ namespace stoat {
     void Position::dropPiece(Square sq, Piece piece, Observer observer) {
         auto& hand = m_hands[piece.color().idx()];
 
-        assert(!pieceOn(sq));
+        assert(pieceOn(sq) == Pieces::kNone);
         assert(hand.count(piece.type()) > 0);
 
         addPiece(sq, piece);
@@ -952,7 +1266,7 @@ namespace stoat {
         const auto stm = this->stm();
         m_checkers = attackersTo(kingSq(stm), stm.flip());
 
-        updateSlidingCheckersAndPins();
+        invalidatePins();
     }
 
     void Position::updateAttacks(Square to) {
@@ -964,18 +1278,31 @@ namespace stoat {
         assert(pc.color() == stm.flip());
 
         m_checkers = attacks::adjacentAttacks(pc.type(), kingSq(stm), stm) & to.bit();
-        updateSlidingCheckersAndPins();
+        updateSlidingCheckers();
+
+        invalidatePins();
     }
 
-    void Position::updateSlidingCheckersAndPins() {
-        updateSidedSlidingCheckersAndPins(Colors::kBlack);
-        updateSidedSlidingCheckersAndPins(Colors::kWhite);
+    void Position::updateSlidingCheckers() {
+        const auto stm = this->stm();
+        const auto nstm = stm.flip();
+
+        const auto king = kingSq(stm);
+        const auto occ = occupancy();
+
+        const auto lances = pieceBb(PieceTypes::kLance, nstm);
+        const auto bishops = pieceBb(PieceTypes::kBishop, nstm) | pieceBb(PieceTypes::kPromotedBishop, nstm);
+        const auto rooks = pieceBb(PieceTypes::kRook, nstm) | pieceBb(PieceTypes::kPromotedRook, nstm);
+
+        m_checkers |= (attacks::lanceAttacks(king, stm, occ) & lances) | (attacks::bishopAttacks(king, occ) & bishops)
+                    | (attacks::rookAttacks(king, occ) & rooks);
     }
 
-    void Position::updateSidedSlidingCheckersAndPins(Color defender) {
+    void Position::updatePins(Color defender) const {
         const auto attacker = defender.flip();
 
         m_pinned[defender.idx()] = Bitboards::kEmpty;
+        m_stalePins &= ~(1 << defender.idx());
 
         const auto defenderKing = kingSq(defender);
 
@@ -987,16 +1314,14 @@ namespace stoat {
             pieceBb(PieceTypes::kBishop, attacker) | pieceBb(PieceTypes::kPromotedBishop, attacker);
         const auto attackerRooks = pieceBb(PieceTypes::kRook, attacker) | pieceBb(PieceTypes::kPromotedRook, attacker);
 
-        auto potentialAttackers = (attacks::lanceAttacks(defenderKing, defender, attackerOcc) & attackerLances)
-                                | (attacks::bishopAttacks(defenderKing, attackerOcc) & attackerBishops)
-                                | (attacks::rookAttacks(defenderKing, attackerOcc) & attackerRooks);
-        while (!potentialAttackers.empty()) {
-            const auto potentialAttacker = potentialAttackers.popLsb();
-            const auto maybePinned = defenderOcc & rayBetween(potentialAttacker, defenderKing);
+        auto potentialPinners = (attacks::lanceAttacks(defenderKing, defender, attackerOcc) & attackerLances)
+                              | (attacks::bishopAttacks(defenderKing, attackerOcc) & attackerBishops)
+                              | (attacks::rookAttacks(defenderKing, attackerOcc) & attackerRooks);
+        while (!potentialPinners.empty()) {
+            const auto potentialPinner = potentialPinners.popLsb();
+            const auto maybePinned = defenderOcc & rayBetween(potentialPinner, defenderKing);
 
-            if (defender == stm() && maybePinned.empty()) {
-                m_checkers |= potentialAttacker.bit();
-            } else if (maybePinned.one()) {
+            if (maybePinned.one()) {
                 m_pinned[defender.idx()] |= maybePinned;
             }
         }
@@ -1023,6 +1348,13 @@ namespace stoat {
         updateAttacks();
     }
 
+    bool Position::operator==(const Position& other) const {
+        return m_colors == other.m_colors && m_pieces == other.m_pieces && m_checkers == other.m_checkers
+            && m_keys == other.m_keys && m_mailbox == other.m_mailbox && m_hands == other.m_hands
+            && m_consecutiveChecks == other.m_consecutiveChecks && m_kingSquares == other.m_kingSquares
+            && m_stm == other.m_stm && m_moveCount == other.m_moveCount;
+    }
+
     Position Position::startpos() {
         Position pos{};
 
@@ -1173,6 +1505,136 @@ namespace stoat {
 
         return fromSfenParts(parts);
     }
+
+    std::optional<PackedSfen> Position::packSfen() const {
+        for (const auto pt : kHandPieces) {
+            const auto onBoard = m_pieces[pt.idx()].popcount()
+                               + (pt == PieceTypes::kGold ? 0 : m_pieces[pt.promoted().idx()].popcount());
+            const auto inHand = static_cast<i32>(hand(Colors::kBlack).count(pt) + hand(Colors::kWhite).count(pt));
+
+            if (onBoard + inHand != kPackedPieceCounts[pt.idx()]) {
+                return {};
+            }
+        }
+
+        PackedSfenWriter writer{};
+
+        writer.write(m_stm.raw(), 1);
+
+        writer.write(PackedSfen::squareIdx(kingSq(Colors::kBlack)), 7);
+        writer.write(PackedSfen::squareIdx(kingSq(Colors::kWhite)), 7);
+
+        // kings have zero-width codes, and are skipped without a branch
+        for (const auto sq : kPackedSquares) {
+            const auto [code, bits] = kPackedPieceCodes<false>[pieceOn(sq).raw()];
+            writer.write(code, bits);
+        }
+
+        for (const auto c : {Colors::kBlack, Colors::kWhite}) {
+            const auto& hand = m_hands[c.idx()];
+
+            for (const auto pt : kHandPieces) {
+                const auto [code, bits] = kPackedPieceCodes<true>[pt.withColor(c).raw()];
+
+                for (u32 i = 0; i < hand.count(pt); ++i) {
+                    writer.write(code, bits);
+                }
+            }
+        }
+
+        return writer.finish();
+    }
+
+    util::Result<Position, SfenError> Position::fromPackedSfen(const PackedSfen& packed, u32 moveCount) {
+        PackedSfenReader reader{packed};
+
+        Position pos{};
+
+        pos.m_stm = Color::fromRaw(reader.read(1));
+
+        const auto blackKingIdx = reader.read(7);
+        const auto whiteKingIdx = reader.read(7);
+
+        if (blackKingIdx >= Squares::kCount || whiteKingIdx >= Squares::kCount) {
+            return util::err<SfenError>("invalid king square");
+        }
+
+        if (blackKingIdx == whiteKingIdx) {
+            return util::err<SfenError>("kings on same square");
+        }
+
+        // keys are generated once at the end instead of incrementally by addPiece
+        const auto placePiece = [&](Square sq, Piece piece) {
+            pos.m_colors[piece.color().idx()] |= sq.bit();
+            pos.m_pieces[piece.type().idx()] |= sq.bit();
+            pos.m_mailbox[sq.idx()] = piece;
+        };
+
+        const auto blackKingSq = kPackedSquares[blackKingIdx];
+        const auto whiteKingSq = kPackedSquares[whiteKingIdx];
+
+        placePiece(blackKingSq, Pieces::kBlackKing);
+        placePiece(whiteKingSq, Pieces::kWhiteKing);
+
+        pos.m_kingSquares.squares[Colors::kBlack.idx()] = blackKingSq;
+        pos.m_kingSquares.squares[Colors::kWhite.idx()] = whiteKingSq;
+
+        std::array<i32, kHandPieces.size()> counts{};
+
+        for (const auto sq : kPackedSquares) {
+            if (sq == blackKingSq || sq == whiteKingSq) {
+                continue;
+            }
+
+            const auto [piece, bits] = kPackedDecodeTable<false>[reader.peek()];
+            reader.skip(bits);
+
+            if (piece == Pieces::kNone) {
+                continue;
+            }
+
+            const auto pt = piece.type().unpromoted();
+
+            if (++counts[pt.idx()] > kPackedPieceCounts[pt.idx()]) {
+                return util::err<SfenError>("too many pieces");
+            }
+
+            placePiece(sq, piece);
+        }
+
+        while (reader.cursor() < kPackedSfenBits) {
+            const auto [piece, bits] = kPackedDecodeTable<true>[reader.peek()];
+            reader.skip(bits);
+
+            if (piece == Pieces::kNone) {
+                return util::err<SfenError>("promoted piece in hand");
+            }
+
+            const auto pt = piece.type();
+
+            if (++counts[pt.idx()] > kPackedPieceCounts[pt.idx()]) {
+                return util::err<SfenError>("too many pieces");
+            }
+
+            auto& hand = pos.m_hands[piece.color().idx()];
+            hand.set(pt, hand.count(pt) + 1);
+        }
+
+        if (reader.cursor() != kPackedSfenBits) {
+            return util::err<SfenError>("packed position overflows 256 bits");
+        }
+
+        pos.m_moveCount = static_cast<u16>(moveCount);
+
+        pos.regenKey();
+        pos.updateAttacks();
+
+        if (pos.isInCheck()) {
+            pos.m_consecutiveChecks[pos.stm().idx()] = 1;
+        }
+
+        return util::ok(pos);
+    }
 } // namespace stoat
 
 fmt::format_context::iterator fmt::formatter<stoat::Position>::format(
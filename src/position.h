@@ -21,6 +21,7 @@
 #include "types.h"
 
 #include <array>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -49,6 +50,9 @@ namespace stoat {
 
         void set(PieceType pt, u32 count);
 
+        // whether this hand holds at least as many of every piece as other
+        [[nodiscard]] bool isSupersetOf(Hand other) const;
+
         [[nodiscard]] static Hand fromRaw(u32 raw);
 
         [[nodiscard]] std::string sfen(bool uppercase) const;
@@ -75,6 +79,21 @@ namespace stoat {
         std::string m_message{};
     };
 
+    // 256-bit Huffman-coded position, bit-compatible with the PackedSfen
+    // format used by YaneuraOu and most shogi training data. Only positions
+    // holding the full set of 40 pieces can be packed, and the move count is
+    // not stored
+    struct PackedSfen {
+        std::array<u8, 32> data{};
+
+        [[nodiscard]] bool operator==(const PackedSfen&) const = default;
+
+        // PackedSfen numbers squares 1a, 1b, ..., 9i
+        [[nodiscard]] static constexpr u32 squareIdx(Square sq) {
+            return (8 - sq.file()) * 9 + (8 - sq.rank());
+        }
+    };
+
     struct PositionKeys {
         u64 all{};
         u64 castle{};
@@ -105,6 +124,8 @@ namespace stoat {
         kNone = 0,
         kDraw,
         kWin, // perpetual check by opponent
+        kSuperior, // same board as an earlier position, with more pieces in hand for the side to move
+        kInferior, // same board as an earlier position, with fewer pieces in hand for the side to move
     };
 
     namespace eval::nnue {
@@ -129,6 +150,7 @@ namespace stoat {
     };
 
     class Position;
+    class RepetitionTable;
 
     struct NullObserver {
         void prepareKingMove(Color c, Square src, Square dst) {
@@ -223,6 +245,9 @@ namespace stoat {
             return m_keys.all;
         }
 
+        // key of the pieces on the board and the side to move, excluding hands
+        [[nodiscard]] u64 boardKey() const;
+
         [[nodiscard]] inline u64 castleKey() const {
             return m_keys.castle;
         }
@@ -249,7 +274,15 @@ namespace stoat {
             return m_checkers;
         }
 
+        // pins are computed lazily on first access after each move, so
+        // a position must not be shared between threads without copying it
         [[nodiscard]] inline Bitboard pinned(Color color) const {
+            assert(color);
+
+            if (m_stalePins & (1 << color.idx())) {
+                updatePins(color);
+            }
+
             return m_pinned[color.idx()];
         }
 
@@ -276,11 +309,26 @@ namespace stoat {
             i32 limit = 16
         ) const;
 
+        // as above, but also reports earlier occurrences of the same board with
+        // a superior or inferior hand for the side to move
+        [[nodiscard]] SennichiteStatus testSennichite(
+            bool cuteChessWorkaround,
+            const RepetitionTable& repetitions,
+            i32 limit = 16
+        ) const;
+
+        // whether the side to move has a move that repeats a position from no more than limit plies
+        // back, found with the cuckoo table. Only considers repetitions that cannot be perpetual checks
+        [[nodiscard]] bool hasUpcomingRepetition(std::span<const u64> keyHistory, i32 limit = 16) const;
+
         [[nodiscard]] bool isEnteringKingsWin() const;
 
         [[nodiscard]] bool isPseudolegal(Move move) const;
         [[nodiscard]] bool isLegal(Move move) const;
 
+        // whether dropping a pawn on the given square, directly in front of the opponent's king, would be mate
+        [[nodiscard]] bool isDropPawnMate(Square sq) const;
+
         [[nodiscard]] bool isCapture(Move move) const;
 
         [[nodiscard]] bool isAttacked(Square sq, Color attacker, Bitboard occ) const;
@@ -295,9 +343,13 @@ namespace stoat {
 
         [[nodiscard]] std::string sfen() const;
 
+        // Returns nothing if any pieces are missing from both the board and the hands, as in handicap games
+        [[nodiscard]] std::optional<PackedSfen> packSfen() const;
+
         void regenKey();
 
-        [[nodiscard]] bool operator==(const Position&) const = default;
+        // ignores the lazily computed pins
+        [[nodiscard]] bool operator==(const Position& other) const;
 
         Position& operator=(const Position&) = default;
         Position& operator=(Position&&) = default;
@@ -307,29 +359,39 @@ namespace stoat {
         [[nodiscard]] static util::Result<Position, SfenError> fromSfenParts(std::span<std::string_view> sfen);
         [[nodiscard]] static util::Result<Position, SfenError> fromSfen(std::string_view sfen);
 
+        [[nodiscard]] static util::Result<Position, SfenError> fromPackedSfen(
+            const PackedSfen& packed,
+            u32 moveCount = 1
+        );
+
         friend std::ostream& operator<<(std::ostream& stream, const Position& pos);
 
     private:
+        // Positions are copied on every move. Keep the 16-byte aligned
+        // bitboards first and the small fields last, so there's no padding
         std::array<Bitboard, Colors::kCount> m_colors{};
         std::array<Bitboard, PieceTypes::kCount> m_pieces{};
 
+        Bitboard m_checkers{};
+        mutable std::array<Bitboard, 2> m_pinned{};
+
+        PositionKeys m_keys{};
+
         std::array<Piece, Squares::kCount> m_mailbox{};
 
         std::array<Hand, Colors::kCount> m_hands{};
 
         std::array<u16, Colors::kCount> m_consecutiveChecks{};
 
-        PositionKeys m_keys{};
-
-        Bitboard m_checkers{};
-        std::array<Bitboard, 2> m_pinned{};
-
         KingPair m_kingSquares{};
 
         Color m_stm{Colors::kBlack};
 
         u16 m_moveCount{1};
 
+        // one bit per color, set when that side's pins need recomputing
+        mutable u8 m_stalePins{0b11};
+
         void addPiece(Square sq, Piece piece);
 
         template <typename Observer>
@@ -341,10 +403,17 @@ namespace stoat {
 
         void updateAttacks();
         void updateAttacks(Square to);
-        void updateSlidingCheckersAndPins();
-        void updateSidedSlidingCheckersAndPins(Color side);
+        void updateSlidingCheckers();
+
+        inline void invalidatePins() {
+            m_stalePins = 0b11;
+        }
+
+        void updatePins(Color defender) const;
 
         void regen();
+
+        [[nodiscard]] SennichiteStatus exactRepetitionStatus(bool cuteChessWorkaround) const;
     };
 } // namespace stoat
 
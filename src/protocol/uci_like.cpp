@@ -30,6 +30,33 @@
 #include "common.h"
 
 namespace stoat::protocol {
+    namespace {
+        // [threads] [hash]
+        [[nodiscard]] std::optional<PerftOptions> parsePerftOptions(std::span<std::string_view> args) {
+            PerftOptions options{};
+
+            if (args.size() >= 1) {
+                if (!util::tryParse(options.threads, args[0])) {
+                    fmt::println(stderr, "Invalid thread count '{}'", args[0]);
+                    return {};
+                }
+
+                options.threads = kPerftThreadRange.clamp(options.threads);
+            }
+
+            if (args.size() >= 2) {
+                if (!util::tryParse(options.hashMib, args[1])) {
+                    fmt::println(stderr, "Invalid hash size '{}'", args[1]);
+                    return {};
+                }
+
+                options.hashMib = kPerftHashRange.clamp(options.hashMib);
+            }
+
+            return options;
+        }
+    } // namespace
+
     UciLikeHandler::UciLikeHandler(EngineState& state) :
             m_state{state} {
 #define REGISTER_HANDLER(Command) \
@@ -39,8 +66,10 @@ namespace stoat::protocol {
         REGISTER_HANDLER(go);
         REGISTER_HANDLER(stop);
         REGISTER_HANDLER(setoption);
+        REGISTER_HANDLER(debug);
 
         REGISTER_HANDLER(d);
+        REGISTER_HANDLER(perft);
         REGISTER_HANDLER(splitperft);
         REGISTER_HANDLER(raweval);
 
@@ -194,7 +223,7 @@ namespace stoat::protocol {
         m_state.searcher->newGame();
     }
 
-    void UciLikeHandler::handle_position(std::span<std::string_view> args, [[maybe_unused]] util::Instant startTime) {
+    void UciLikeHandler::handle_position(std::span<std::string_view> args, util::Instant startTime) {
         if (m_state.searcher->isSearching()) {
             fmt::println(stderr, "Still searching");
             return;
@@ -204,24 +233,36 @@ namespace stoat::protocol {
             return;
         }
 
-        usize next = 0;
+        const auto baseCount = args[0] == "startpos"
+                                 ? 1
+                                 : static_cast<usize>(std::distance(args.begin(), std::ranges::find(args, "moves")));
 
-        if (args[0] == "startpos") {
-            m_state.pos = Position::startpos();
-            m_state.keyHistory.clear();
+        if (baseCount == 0) {
+            fmt::println(stderr, "Missing position");
+            return;
+        }
 
-            next = 1;
-        } else {
-            const auto count = std::distance(args.begin(), std::ranges::find(args, "moves"));
+        const auto base = args.subspan(0, baseCount);
 
-            if (count == 0) {
-                fmt::println(stderr, "Missing position");
-                return;
-            }
+        std::span<std::string_view> moves{};
 
-            if (auto parsed = parsePosition(args.subspan(0, count))) {
+        if (baseCount < args.size() && args[baseCount] == "moves") {
+            moves = args.subspan(baseCount + 1);
+        }
+
+        // if this command only extends the previous one, the current
+        // position is already the result of all but the new moves
+        const bool incremental = !m_lastPositionBase.empty() && std::ranges::equal(base, m_lastPositionBase)
+                              && m_lastPositionMoves.size() <= moves.size()
+                              && std::ranges::equal(moves.subspan(0, m_lastPositionMoves.size()), m_lastPositionMoves);
+
+        if (incremental) {
+            moves = moves.subspan(m_lastPositionMoves.size());
+        } else {
+            if (args[0] == "startpos") {
+                m_state.pos = Position::startpos();
+            } else if (auto parsed = parsePosition(base)) {
                 m_state.pos = parsed.take();
-                m_state.keyHistory.clear();
             } else {
                 if (const auto err = parsed.takeErr()) {
                     fmt::println("{}", *err);
@@ -229,24 +270,34 @@ namespace stoat::protocol {
                 return;
             }
 
-            next = count;
-        }
-
-        assert(next <= args.size());
+            m_state.keyHistory.clear();
 
-        if (next >= args.size() || args[next] != "moves") {
-            return;
+            m_lastPositionBase.assign(base.begin(), base.end());
+            m_lastPositionMoves.clear();
         }
 
-        for (usize i = next + 1; i < args.size(); ++i) {
-            if (auto parsedMove = parseMove(args[i])) {
+        usize applied = 0;
+
+        for (const auto moveStr : moves) {
+            if (auto parsedMove = parseMove(moveStr)) {
                 m_state.keyHistory.push_back(m_state.pos.key());
                 m_state.pos = m_state.pos.applyMove(parsedMove.take());
+                m_lastPositionMoves.emplace_back(moveStr);
+                ++applied;
             } else {
-                fmt::println(stderr, "Invalid move '{}'", args[i]);
+                fmt::println(stderr, "Invalid move '{}'", moveStr);
                 break;
             }
         }
+
+        if (m_debug) {
+            printInfoString(fmt::format(
+                "position set in {:.3f} ms ({}, {} moves applied)",
+                startTime.elapsed() * 1000.0,
+                incremental ? "incremental" : "full",
+                applied
+            ));
+        }
     }
 
     void UciLikeHandler::handle_go(std::span<std::string_view> args, util::Instant startTime) {
@@ -524,6 +575,16 @@ namespace stoat::protocol {
         }
     }
 
+    void UciLikeHandler::handle_debug(std::span<std::string_view> args, [[maybe_unused]] util::Instant startTime) {
+        if (args.empty() || args[0] == "on") {
+            m_debug = true;
+        } else if (args[0] == "off") {
+            m_debug = false;
+        } else {
+            fmt::println(stderr, "Invalid debug mode '{}'", args[0]);
+        }
+    }
+
     void UciLikeHandler::handle_d(
         [[maybe_unused]] std::span<std::string_view> args,
         [[maybe_unused]] util::Instant startTime
@@ -561,13 +622,33 @@ namespace stoat::protocol {
         fmt::println("Static eval: {:+}.{:02}", staticEval / 100, std::abs(staticEval) % 100);
     }
 
+    void UciLikeHandler::handle_perft(std::span<std::string_view> args, [[maybe_unused]] util::Instant startTime) {
+        if (args.empty()) {
+            return;
+        }
+
+        const auto depth = util::tryParse<i32>(args[0]);
+        if (!depth) {
+            return;
+        }
+
+        if (const auto options = parsePerftOptions(args.subspan<1>())) {
+            perft(m_state.pos, *depth, *options);
+        }
+    }
+
     void UciLikeHandler::handle_splitperft(std::span<std::string_view> args, [[maybe_unused]] util::Instant startTime) {
         if (args.empty()) {
             return;
         }
 
-        if (const auto depth = util::tryParse<i32>(args[0])) {
-            splitPerft(m_state.pos, *depth);
+        const auto depth = util::tryParse<i32>(args[0]);
+        if (!depth) {
+            return;
+        }
+
+        if (const auto options = parsePerftOptions(args.subspan<1>())) {
+            splitPerft(m_state.pos, *depth, *options);
         }
     }
 
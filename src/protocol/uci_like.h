@@ -24,6 +24,7 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "../util/result.h"
 #include "../util/string_map.h"
@@ -87,13 +88,22 @@ namespace stoat::protocol {
     private:
         util::UnorderedStringMap<CommandHandlerType> m_cmdHandlers{};
 
+        // base position and moves that produced m_state.pos, used
+        // to apply only the new moves when a position command extends them
+        std::vector<std::string> m_lastPositionBase{};
+        std::vector<std::string> m_lastPositionMoves{};
+
+        bool m_debug{};
+
         void handle_position(std::span<std::string_view> args, util::Instant startTime);
         void handle_go(std::span<std::string_view> args, util::Instant startTime);
         void handle_stop(std::span<std::string_view> args, util::Instant startTime);
         void handle_setoption(std::span<std::string_view> args, util::Instant startTime);
+        void handle_debug(std::span<std::string_view> args, util::Instant startTime);
 
         // nonstandard
         void handle_d(std::span<std::string_view> args, util::Instant startTime);
+        void handle_perft(std::span<std::string_view> args, util::Instant startTime);
         void handle_splitperft(std::span<std::string_view> args, util::Instant startTime);
         void handle_raweval(std::span<std::string_view> args, util::Instant startTime);
     };
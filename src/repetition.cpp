@@ -0,0 +1,122 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "repetition.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "core.h"
+
+namespace stoat {
+    RepetitionTable::RepetitionTable() {
+        m_entries.reserve(kMaxDepth + 1);
+        m_heads.fill(-1);
+    }
+
+    void RepetitionTable::reset(std::span<const u64> keyHistory) {
+        m_rootKeys.clear();
+        m_rootKeys.reserve(keyHistory.size());
+
+        std::ranges::copy(keyHistory, std::back_inserter(m_rootKeys));
+
+        m_entries.clear();
+        m_heads.fill(-1);
+    }
+
+    void RepetitionTable::push(const Position& pos) {
+        const auto boardKey = pos.boardKey();
+        auto& head = m_heads[bucket(boardKey)];
+
+        m_entries.push_back({
+            .key = pos.key(),
+            .boardKey = boardKey,
+            .hand = pos.hand(pos.stm()),
+            .prev = head,
+        });
+
+        head = static_cast<i32>(m_entries.size() - 1);
+    }
+
+    void RepetitionTable::pop() {
+        assert(!m_entries.empty());
+
+        const auto& entry = m_entries.back();
+        m_heads[bucket(entry.boardKey)] = entry.prev;
+
+        m_entries.pop_back();
+    }
+
+    RepetitionType RepetitionTable::find(const Position& pos, i32 limit) const {
+        // indices into the combined history, as in keyHistory
+        const auto rootSize = static_cast<i32>(m_rootKeys.size());
+        const auto size = static_cast<i32>(this->size());
+
+        const auto end = std::max(0, size - limit - 1);
+        const auto last = size - 4;
+
+        if (last < end) {
+            return RepetitionType::kNone;
+        }
+
+        const auto key = pos.key();
+        const auto boardKey = pos.boardKey();
+        const auto hand = pos.hand(pos.stm());
+
+        auto result = RepetitionType::kNone;
+
+        for (auto idx = m_heads[bucket(boardKey)]; idx >= 0 && rootSize + idx >= end; idx = m_entries[idx].prev) {
+            const auto& entry = m_entries[idx];
+
+            if (rootSize + idx > last || entry.boardKey != boardKey) {
+                continue;
+            }
+
+            if (entry.key == key) {
+                return RepetitionType::kExact;
+            }
+
+            if (result != RepetitionType::kNone) {
+                continue;
+            }
+
+            if (hand == entry.hand) {
+                continue;
+            }
+
+            if (hand.isSupersetOf(entry.hand)) {
+                result = RepetitionType::kSuperior;
+            } else if (entry.hand.isSupersetOf(hand)) {
+                result = RepetitionType::kInferior;
+            }
+        }
+
+        // the last position before the root with the same side to move as pos
+        auto start = last;
+        if (start >= rootSize) {
+            start -= (start - rootSize + 2) / 2 * 2;
+        }
+
+        for (i32 i = start; i >= end; i -= 2) {
+            if (m_rootKeys[i] == key) {
+                return RepetitionType::kExact;
+            }
+        }
+
+        return result;
+    }
+} // namespace stoat
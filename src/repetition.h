@@ -0,0 +1,79 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "types.h"
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "position.h"
+
+namespace stoat {
+    enum class RepetitionType {
+        kNone = 0,
+        kExact,
+        kSuperior, // same board, side to move has strictly more pieces in hand
+        kInferior, // same board, side to move has strictly fewer pieces in hand
+    };
+
+    // Per-thread history of the positions on the current search path, indexed
+    // by a hash of their board-only keys. Each entry links to the previous entry
+    // in the same bucket, so a lookup only visits positions that are likely to
+    // share the board with the one being tested. Positions from before the root
+    // are only known by their full keys, so only exact repetitions of them are
+    // found, by a scan bounded by the lookup limit
+    class RepetitionTable {
+    public:
+        RepetitionTable();
+
+        void reset(std::span<const u64> keyHistory);
+
+        void push(const Position& pos);
+        void pop();
+
+        // looks for the most recent earlier occurrence of pos's board with the
+        // same side to move, no more than limit plies back. Exact repetitions take
+        // priority over superior or inferior hands
+        [[nodiscard]] RepetitionType find(const Position& pos, i32 limit) const;
+
+        [[nodiscard]] inline usize size() const {
+            return m_rootKeys.size() + m_entries.size();
+        }
+
+    private:
+        static constexpr usize kBuckets = 1024;
+
+        struct Entry {
+            u64 key;
+            u64 boardKey;
+            Hand hand;
+            i32 prev;
+        };
+
+        [[nodiscard]] static constexpr usize bucket(u64 boardKey) {
+            return boardKey % kBuckets;
+        }
+
+        std::vector<u64> m_rootKeys{};
+
+        std::vector<Entry> m_entries{};
+        std::array<i32, kBuckets> m_heads{};
+    };
+} // namespace stoat
@@ -27,6 +27,7 @@
 #include "eval/eval.h"
 #include "history.h"
 #include "movepick.h"
+#include "perf_counters.h"
 #include "protocol/handler.h"
 #include "see.h"
 #include "stats.h"
@@ -71,21 +72,21 @@ namespace stoat {
             return reductions;
         }();
 
-        void generateLegal(movegen::MoveList& dst, const Position& pos) {
-            movegen::MoveList generated{};
-            movegen::generateAll<true>(generated, pos);
-
-            for (const auto move : generated) {
-                if (pos.isLegal(move)) {
-                    dst.push(move);
-                }
-            }
-        }
-
         [[nodiscard]] constexpr Score drawScore(usize nodes) {
             return 2 - static_cast<Score>(nodes % 4);
         }
 
+        // Margin over the draw score for the side to move when a position repeats the board
+        // of an earlier one with a strictly superior hand - the opponent's moves in between
+        // only lost material. Path-dependent and unproven, so kept to roughly the value of the
+        // material gained rather than anything near a win, and well clear of datagen's
+        // win adjudication
+        constexpr Score kSuperiorMargin = 300;
+
+        [[nodiscard]] constexpr Score superiorScore(usize nodes) {
+            return drawScore(nodes) + kSuperiorMargin;
+        }
+
         [[nodiscard]] constexpr bool isDecisive(Score score) {
             return std::abs(score) > kScoreWin;
         }
@@ -170,6 +171,11 @@ namespace stoat {
         m_cuteChessWorkaround = enabled;
     }
 
+    void Searcher::setSilent(bool silent) {
+        assert(!isSearching());
+        m_silent = silent;
+    }
+
     void Searcher::setLimiter(limit::SearchLimiter limiter) {
         m_limiter = limiter;
     }
@@ -229,6 +235,7 @@ namespace stoat {
         }
 
         m_startTime = startTime;
+        m_depthTimes.clear();
 
         m_stop.store(false);
 
@@ -268,34 +275,46 @@ namespace stoat {
         return *m_threadData[0];
     }
 
-    void Searcher::runBenchSearch(BenchInfo& info) {
-        auto& thread = *m_threadData[0];
+    void Searcher::runBenchSearch(const Position& pos, i32 maxDepth, BenchInfo& info) {
+        runBenchSearch(pos, limit::SearchLimiter{util::Instant::now()}, maxDepth, info);
+    }
 
-        if (initRootMoves(m_rootMoveList, thread.rootPos) == RootStatus::kNoLegalMoves) {
-            protocol::currHandler().printInfoString("no legal moves");
+    void Searcher::runBenchSearch(const Position& pos, limit::SearchLimiter limiter, i32 maxDepth, BenchInfo& info) {
+        info = {};
+
+        // startSearch would report these to the gui instead of searching
+        movegen::MoveList rootMoves{};
+        if (initRootMoves(rootMoves, pos) == RootStatus::kNoLegalMoves || pos.isEnteringKingsWin()) {
             return;
         }
 
-        const auto currLimiter = thread.limiter;
+        const auto startTime = util::Instant::now();
 
-        thread.limiter = limit::SearchLimiter{util::Instant::now()};
+        setLimiter(limiter);
+        startSearch(pos, {}, startTime, false, maxDepth);
 
-        m_multiPv = 1;
-        m_infinite = false;
-
-        thread.nnueState.reset(thread.rootPos);
+        {
+            std::unique_lock lock{m_stopMutex};
+            m_stopSignal.wait(lock, [this] { return m_runningThreads.load() == 0; });
+        }
 
-        m_runningThreads.store(1);
-        m_stop.store(false);
+        // the main thread holds this until it has finished reporting
+        const std::unique_lock lock{m_searchMutex};
 
-        m_startTime = util::Instant::now();
+        info.time = startTime.elapsed();
 
-        runSearch(thread);
+        for (const auto& thread : m_threadData) {
+            info.nodes += thread->loadNodes();
+        }
 
-        info.time = m_startTime.elapsed();
-        info.nodes = thread.loadNodes();
+        const auto& bestThread = selectThread();
+        const auto& pvMove = bestThread.pvMove();
 
-        thread.limiter = currLimiter;
+        info.depth = bestThread.depthCompleted;
+        info.seldepth = pvMove.seldepth;
+        info.bestMove = pvMove.pv.moves[0];
+        info.hashfull = m_lastHashfull;
+        info.depthTimes = m_depthTimes;
     }
 
     void Searcher::runDatagenSearch() {
@@ -316,6 +335,8 @@ namespace stoat {
         m_multiPv = 1;
         m_infinite = false;
 
+        m_depthTimes.clear();
+
         m_stop.store(false);
         ++m_runningThreads;
 
@@ -336,7 +357,7 @@ namespace stoat {
 
     Searcher::RootStatus Searcher::initRootMoves(movegen::MoveList& dst, const Position& pos) {
         dst.clear();
-        generateLegal(dst, pos);
+        movegen::generateLegal<true>(dst, pos);
         return dst.empty() ? Searcher::RootStatus::kNoLegalMoves : Searcher::RootStatus::kGenerated;
     }
 
@@ -384,6 +405,8 @@ namespace stoat {
     }
 
     void Searcher::runSearch(ThreadData& thread) {
+        const perf::ScopedPhase phase{perf::Phase::kSearch};
+
         assert(!m_rootMoveList.empty());
 
         thread.rootMoves.clear();
@@ -479,6 +502,10 @@ namespace stoat {
 
             thread.depthCompleted = depth;
 
+            if (thread.isMainThread()) {
+                m_depthTimes.push_back(m_startTime.elapsed());
+            }
+
             if (depth >= thread.maxDepth) {
                 break;
             }
@@ -518,6 +545,9 @@ namespace stoat {
 
             finalReport(m_startTime.elapsed());
 
+            // must be sampled before aging
+            m_lastHashfull = m_ttable.fullPermille();
+
             m_ttable.age();
             stats::print();
 
@@ -570,6 +600,17 @@ namespace stoat {
             return qsearch<kPvNode>(thread, pos, ply, alpha, beta);
         }
 
+        if constexpr (!kRootNode) {
+            if (const auto draw = drawScore(thread.loadNodes());
+                alpha < draw && !m_cuteChessWorkaround && pos.hasUpcomingRepetition(thread.keyHistory))
+            {
+                alpha = draw;
+                if (alpha >= beta) {
+                    return alpha;
+                }
+            }
+        }
+
         thread.incNodes();
 
         if constexpr (kPvNode) {
@@ -710,13 +751,12 @@ namespace stoat {
                 continue;
             }
 
+            assert(pos.isLegal(move));
+
             if constexpr (kRootNode) {
                 if (!thread.isLegalRootMove(move)) {
                     continue;
                 }
-                assert(pos.isLegal(move));
-            } else if (!pos.isLegal(move)) {
-                continue;
             }
 
             const auto baseLmr = s_lmrTable[depth][std::min<u32>(legalMoves, kLmrTableMoves - 1)];
@@ -783,7 +823,7 @@ namespace stoat {
             m_ttable.prefetch(pos.keyAfter(move));
 
             const auto [newPos, guard] = thread.applyMove(ply, pos, move);
-            const auto sennichite = newPos.testSennichite(m_cuteChessWorkaround, thread.keyHistory);
+            const auto sennichite = newPos.testSennichite(m_cuteChessWorkaround, thread.repetitions);
 
             const bool givesCheck = newPos.isInCheck();
 
@@ -798,6 +838,13 @@ namespace stoat {
             } else if (sennichite == SennichiteStatus::kDraw) {
                 score = drawScore(thread.loadNodes());
                 goto skipSearch;
+            } else if (sennichite == SennichiteStatus::kSuperior && !thread.datagen) {
+                // (not in datagen - these scores should not end up in training data)
+                score = -superiorScore(thread.loadNodes());
+                goto skipSearch;
+            } else if (sennichite == SennichiteStatus::kInferior && !thread.datagen) {
+                score = superiorScore(thread.loadNodes());
+                goto skipSearch;
             } else if (pos.isEnteringKingsWin()) {
                 score = kScoreMate - ply - 1;
                 goto skipSearch;
@@ -981,6 +1028,15 @@ namespace stoat {
             }
         }
 
+        if (const auto draw = drawScore(thread.loadNodes());
+            alpha < draw && !m_cuteChessWorkaround && pos.hasUpcomingRepetition(thread.keyHistory))
+        {
+            alpha = draw;
+            if (alpha >= beta) {
+                return alpha;
+            }
+        }
+
         thread.incNodes();
 
         if constexpr (kPvNode) {
@@ -1042,10 +1098,7 @@ namespace stoat {
 
         while (const auto move = generator.next()) {
             assert(pos.isPseudolegal(move));
-
-            if (!pos.isLegal(move)) {
-                continue;
-            }
+            assert(pos.isLegal(move));
 
             if (bestScore > -kScoreWin) {
                 if (!see::see(pos, move, -77)) {
@@ -1067,7 +1120,7 @@ namespace stoat {
             m_ttable.prefetch(pos.keyAfter(move));
 
             const auto [newPos, guard] = thread.applyMove(ply, pos, move);
-            const auto sennichite = newPos.testSennichite(m_cuteChessWorkaround, thread.keyHistory);
+            const auto sennichite = newPos.testSennichite(m_cuteChessWorkaround, thread.repetitions);
 
             Score score;
 
@@ -1076,6 +1129,10 @@ namespace stoat {
                 continue;
             } else if (sennichite == SennichiteStatus::kDraw) {
                 score = drawScore(thread.loadNodes());
+            } else if (sennichite == SennichiteStatus::kSuperior && !thread.datagen) {
+                score = -superiorScore(thread.loadNodes());
+            } else if (sennichite == SennichiteStatus::kInferior && !thread.datagen) {
+                score = superiorScore(thread.loadNodes());
             } else {
                 score = -qsearch<kPvNode>(thread, newPos, ply + 1, -beta, -alpha);
             }
@@ -47,6 +47,12 @@ namespace stoat {
     struct BenchInfo {
         usize nodes{};
         f64 time{};
+        i32 depth{};
+        i32 seldepth{};
+        Move bestMove{kNullMove};
+        u32 hashfull{};
+        // time at which the main thread completed each depth, starting from depth 1
+        std::vector<f64> depthTimes{};
     };
 
     class Searcher {
@@ -62,6 +68,7 @@ namespace stoat {
         void setMultiPv(u32 multipv);
         void setMinimal(bool minimal);
         void setCuteChessWorkaround(bool enabled);
+        void setSilent(bool silent);
 
         void setLimiter(limit::SearchLimiter limiter);
 
@@ -78,7 +85,9 @@ namespace stoat {
         // Makes this object unusable for normal searches, just for benching or datagen
         [[nodiscard]] ThreadData& take();
 
-        void runBenchSearch(BenchInfo& info);
+        // Runs a full search to the given depth on the thread pool, and blocks until it completes
+        void runBenchSearch(const Position& pos, i32 maxDepth, BenchInfo& info);
+        void runBenchSearch(const Position& pos, limit::SearchLimiter limiter, i32 maxDepth, BenchInfo& info);
         void runDatagenSearch();
 
         [[nodiscard]] bool isSearching() const;
@@ -123,6 +132,9 @@ namespace stoat {
 
         movegen::MoveList m_rootMoveList{};
 
+        std::vector<f64> m_depthTimes{};
+        u32 m_lastHashfull{};
+
         tt::TTable m_ttable;
 
         enum class RootStatus {
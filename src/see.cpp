@@ -21,6 +21,7 @@
 #include <algorithm>
 
 #include "attacks/attacks.h"
+#include "perf_counters.h"
 #include "rays.h"
 
 namespace stoat::see {
@@ -77,6 +78,8 @@ namespace stoat::see {
     } // namespace
 
     bool see(const Position& pos, Move move, i32 threshold) {
+        const perf::ScopedPhase phase{perf::Phase::kSee};
+
         const auto stm = pos.stm();
 
         auto score = gain(pos, move) - threshold;
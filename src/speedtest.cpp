@@ -0,0 +1,225 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "speedtest.h"
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "search.h"
+
+namespace stoat::speedtest {
+    namespace {
+        struct ConfigResult {
+            u32 threads{};
+            usize nodes{};
+            f64 time{};
+            u64 hashfullSum{};
+            std::vector<std::vector<f64>> depthTimes{};
+
+            [[nodiscard]] inline f64 nps() const {
+                return time > 0.0 ? static_cast<f64>(nodes) / time : 0.0;
+            }
+        };
+
+        [[nodiscard]] ConfigResult runConfig(
+            std::span<const bench::BenchPosition> positions,
+            u32 threads,
+            const SpeedtestOptions& options
+        ) {
+            ConfigResult result{.threads = threads};
+            result.depthTimes.reserve(positions.size());
+
+            Searcher searcher{options.ttSizeMib};
+
+            searcher.setThreadCount(threads);
+            searcher.setMinimal(true);
+            searcher.setSilent(true);
+
+            searcher.newGame();
+
+            const auto moveTime = static_cast<f64>(options.moveTimeMs) / 1000.0;
+
+            for (usize idx = 0; idx < positions.size(); ++idx) {
+                limit::SearchLimiter limiter{util::Instant::now()};
+                limiter.setMoveTime(moveTime);
+
+                BenchInfo info{};
+                searcher.runBenchSearch(positions[idx].pos, limiter, kMaxDepth, info);
+
+                result.nodes += info.nodes;
+                result.time += info.time;
+                result.hashfullSum += info.hashfull;
+
+                result.depthTimes.push_back(std::move(info.depthTimes));
+
+                fmt::println(
+                    "[{} thread{}] position {}/{}: depth {} seldepth {} nodes {} hashfull {}",
+                    threads,
+                    threads == 1 ? "" : "s",
+                    idx + 1,
+                    positions.size(),
+                    info.depth,
+                    info.seldepth,
+                    info.nodes,
+                    info.hashfull
+                );
+            }
+
+            return result;
+        }
+
+        void printConfig(const ConfigResult& result, const ConfigResult& baseline, usize positionCount) {
+            const auto nps = result.nps();
+            const auto npsPerThread = nps / static_cast<f64>(result.threads);
+
+            const auto baselineNps = baseline.nps();
+            const auto efficiency = baselineNps > 0.0 ? npsPerThread / baselineNps * 100.0 : 0.0;
+
+            const auto hashfull = static_cast<f64>(result.hashfullSum) / static_cast<f64>(positionCount);
+
+            fmt::println(
+                "{:>7} {:>12.0f} {:>12.0f} {:>9.1f}% {:>10.1f} {:>14} {:>9.3f}",
+                result.threads,
+                nps,
+                npsPerThread,
+                efficiency,
+                hashfull,
+                result.nodes,
+                result.time
+            );
+        }
+
+        void printTimeToDepth(const ConfigResult& baseline, const ConfigResult& result) {
+            usize maxDepth{};
+            for (usize idx = 0; idx < baseline.depthTimes.size(); ++idx) {
+                maxDepth = std::max(
+                    maxDepth,
+                    std::min(baseline.depthTimes[idx].size(), result.depthTimes[idx].size())
+                );
+            }
+
+            fmt::println("");
+            fmt::println("time to depth (mean over positions reached by both, ms):");
+            fmt::println(
+                "{:>5} {:>9} {:>12} {:>12} {:>8}",
+                "depth",
+                "positions",
+                "1 thread",
+                fmt::format("{} threads", result.threads),
+                "speedup"
+            );
+
+            for (usize depthIdx = 0; depthIdx < maxDepth; ++depthIdx) {
+                usize count{};
+
+                f64 baselineTotal{};
+                f64 resultTotal{};
+
+                for (usize idx = 0; idx < baseline.depthTimes.size(); ++idx) {
+                    const auto& baselineTimes = baseline.depthTimes[idx];
+                    const auto& resultTimes = result.depthTimes[idx];
+
+                    if (depthIdx >= baselineTimes.size() || depthIdx >= resultTimes.size()) {
+                        continue;
+                    }
+
+                    ++count;
+
+                    baselineTotal += baselineTimes[depthIdx];
+                    resultTotal += resultTimes[depthIdx];
+                }
+
+                if (count == 0) {
+                    continue;
+                }
+
+                const auto baselineMean = baselineTotal / static_cast<f64>(count) * 1000.0;
+                const auto resultMean = resultTotal / static_cast<f64>(count) * 1000.0;
+
+                fmt::println(
+                    "{:>5} {:>9} {:>12.1f} {:>12.1f} {:>7.2f}x",
+                    depthIdx + 1,
+                    count,
+                    baselineMean,
+                    resultMean,
+                    resultMean > 0.0 ? baselineMean / resultMean : 0.0
+                );
+            }
+        }
+    } // namespace
+
+    i32 run(const SpeedtestOptions& options) {
+        std::vector<bench::BenchPosition> positions{};
+        if (!bench::loadPositions(positions, options.sfenFile)) {
+            return 1;
+        }
+
+        auto threads = options.threads;
+
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+
+        threads = kThreadCountRange.clamp(threads);
+
+        fmt::println(
+            "speedtest: {} positions, {} ms per position, {} MiB hash, {} threads",
+            positions.size(),
+            options.moveTimeMs,
+            options.ttSizeMib,
+            threads
+        );
+        fmt::println("");
+
+        const auto baseline = runConfig(positions, 1, options);
+
+        std::optional<ConfigResult> result{};
+
+        if (threads > 1) {
+            fmt::println("");
+            result = runConfig(positions, threads, options);
+        }
+
+        fmt::println("");
+        fmt::println(
+            "{:>7} {:>12} {:>12} {:>10} {:>10} {:>14} {:>9}",
+            "threads",
+            "nps",
+            "nps/thread",
+            "efficiency",
+            "hashfull",
+            "nodes",
+            "time (s)"
+        );
+
+        printConfig(baseline, baseline, positions.size());
+
+        if (result) {
+            printConfig(*result, baseline, positions.size());
+            printTimeToDepth(baseline, *result);
+        }
+
+        return 0;
+    }
+} // namespace stoat::speedtest
@@ -0,0 +1,43 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <optional>
+#include <string>
+
+namespace stoat::speedtest {
+    // 0 = all hardware threads
+    constexpr u32 kDefaultThreads = 0;
+    constexpr usize kDefaultTtSizeMib = 64;
+    constexpr u32 kDefaultMoveTimeMs = 1000;
+
+    struct SpeedtestOptions {
+        u32 threads{kDefaultThreads};
+        usize ttSizeMib{kDefaultTtSizeMib};
+        u32 moveTimeMs{kDefaultMoveTimeMs};
+        // one sfen per line, the bench positions if not given
+        std::optional<std::string> sfenFile{};
+    };
+
+    // Runs fixed-time searches over a set of positions with one thread, then with the given
+    // thread count, and reports nps scaling, hashfull and time-to-depth for each
+    i32 run(const SpeedtestOptions& options = {});
+} // namespace stoat::speedtest
@@ -36,6 +36,8 @@ namespace stoat {
 
         std::ranges::copy(newKeyHistory, std::back_inserter(keyHistory));
 
+        repetitions.reset(newKeyHistory);
+
         stats.seldepth.store(0);
         stats.nodes.store(0);
     }
@@ -45,11 +47,12 @@ namespace stoat {
         conthist[ply] = &history.contTable(pos, move);
 
         keyHistory.push_back(pos.key());
+        repetitions.push(pos);
 
         return std::pair<Position, ThreadPosGuard<true>>{
             std::piecewise_construct,
             std::forward_as_tuple(pos.applyMove(move, nnueState.push())),
-            std::forward_as_tuple(keyHistory, nnueState)
+            std::forward_as_tuple(keyHistory, repetitions, nnueState)
         };
     }
 
@@ -58,11 +61,12 @@ namespace stoat {
         conthist[ply] = nullptr;
 
         keyHistory.push_back(pos.key());
+        repetitions.push(pos);
 
         return std::pair<Position, ThreadPosGuard<false>>{
             std::piecewise_construct,
             std::forward_as_tuple(pos.applyNullMove()),
-            std::forward_as_tuple(keyHistory, nnueState)
+            std::forward_as_tuple(keyHistory, repetitions, nnueState)
         };
     }
 
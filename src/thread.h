@@ -31,6 +31,7 @@
 #include "limit.h"
 #include "position.h"
 #include "pv.h"
+#include "repetition.h"
 #include "root_move.h"
 
 namespace stoat {
@@ -55,14 +56,19 @@ namespace stoat {
     template <bool kUpdateNnue>
     class ThreadPosGuard {
     public:
-        explicit ThreadPosGuard(std::vector<u64>& keyHistory, eval::nnue::NnueState& nnueState) :
-                m_keyHistory{keyHistory}, m_nnueState{nnueState} {}
+        explicit ThreadPosGuard(
+            std::vector<u64>& keyHistory,
+            RepetitionTable& repetitions,
+            eval::nnue::NnueState& nnueState
+        ) :
+                m_keyHistory{keyHistory}, m_repetitions{repetitions}, m_nnueState{nnueState} {}
 
         ThreadPosGuard(const ThreadPosGuard&) = delete;
         ThreadPosGuard(ThreadPosGuard&&) = delete;
 
         inline ~ThreadPosGuard() {
             m_keyHistory.pop_back();
+            m_repetitions.pop();
             if constexpr (kUpdateNnue) {
                 m_nnueState.pop();
             }
@@ -70,6 +76,7 @@ namespace stoat {
 
     private:
         std::vector<u64>& m_keyHistory;
+        RepetitionTable& m_repetitions;
         eval::nnue::NnueState& m_nnueState;
     };
 
@@ -94,6 +101,7 @@ namespace stoat {
 
         Position rootPos{};
         std::vector<u64> keyHistory{};
+        RepetitionTable repetitions{};
 
         SearchStats stats{};
 
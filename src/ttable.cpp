@@ -28,6 +28,7 @@
 
 #include "arch.h"
 #include "core.h"
+#include "perf_counters.h"
 #include "util/align.h"
 
 namespace stoat::tt {
@@ -119,6 +120,8 @@ namespace stoat::tt {
     }
 
     bool TTable::probe(ProbedEntry& dst, u64 key, i32 ply) const {
+        const perf::ScopedPhase phase{perf::Phase::kTtProbe};
+
         assert(!m_pendingInit);
 
         const auto entry = m_entries[index(key)];
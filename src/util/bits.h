@@ -40,6 +40,16 @@ namespace stoat::util {
             return count;
         }
 
+        [[nodiscard]] constexpr i32 clz(u128 v) {
+            i32 count{};
+
+            for (u128 bit = u128{1} << 127; bit != 0 && (v & bit) == 0; bit >>= 1) {
+                ++count;
+            }
+
+            return count;
+        }
+
         [[nodiscard]] constexpr u128 pext(u128 v, u128 mask) {
             u128 dst{};
 
@@ -83,6 +93,20 @@ namespace stoat::util {
         }
     }
 
+    [[nodiscard]] constexpr i32 clz(u128 v) {
+        if (std::is_constant_evaluated()) {
+            return fallback::clz(v);
+        }
+
+        const auto [high, low] = fromU128(v);
+
+        if (high == 0) {
+            return 64 + __builtin_clzll(low);
+        } else {
+            return __builtin_clzll(high);
+        }
+    }
+
     [[nodiscard]] constexpr i32 popcount(u128 v) {
         const auto [high, low] = fromU128(v);
         return std::popcount(high) + std::popcount(low);
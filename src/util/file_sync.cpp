@@ -0,0 +1,98 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "file_sync.h"
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <fmt/std.h>
+
+namespace stoat::util {
+    bool syncFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+        const auto fd = _wopen(path.c_str(), _O_WRONLY | _O_BINARY);
+
+        if (fd < 0) {
+            fmt::println(stderr, "failed to open file \"{}\" for syncing", path);
+            return false;
+        }
+
+        const bool success = _commit(fd) == 0;
+        _close(fd);
+
+        if (!success) {
+            fmt::println(stderr, "failed to sync file \"{}\"", path);
+        }
+
+        return success;
+#else
+        const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            fmt::println(stderr, "failed to open file \"{}\" for syncing: {}", path, std::strerror(errno));
+            return false;
+        }
+
+    #ifdef __APPLE__
+        const bool success = fsync(fd) == 0;
+    #else
+        const bool success = fdatasync(fd) == 0;
+    #endif
+
+        if (!success) {
+            fmt::println(stderr, "failed to sync file \"{}\": {}", path, std::strerror(errno));
+        }
+
+        close(fd);
+
+        return success;
+#endif
+    }
+
+    bool syncDirectory([[maybe_unused]] const std::filesystem::path& path) {
+#ifdef _WIN32
+        return true;
+#else
+        const auto fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (fd < 0) {
+            fmt::println(stderr, "failed to open directory \"{}\" for syncing: {}", path, std::strerror(errno));
+            return false;
+        }
+
+        const bool success = fsync(fd) == 0;
+
+        if (!success) {
+            fmt::println(stderr, "failed to sync directory \"{}\": {}", path, std::strerror(errno));
+        }
+
+        close(fd);
+
+        return success;
+#endif
+    }
+} // namespace stoat::util
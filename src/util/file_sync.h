@@ -0,0 +1,34 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <filesystem>
+
+namespace stoat::util {
+    // Forces a file's contents out of the OS cache and onto the disk, so that they
+    // survive a power loss or host crash. Anything written through a stream must be
+    // flushed first. Prints an error and returns false on failure
+    bool syncFile(const std::filesystem::path& path);
+
+    // Makes renames and newly created files in a directory durable in the same way.
+    // Does nothing on Windows, where directories cannot be synced
+    bool syncDirectory(const std::filesystem::path& path);
+} // namespace stoat::util
@@ -0,0 +1,162 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #ifndef NOMINMAX // mingw
+        #define NOMINMAX
+    #endif
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <fmt/std.h>
+
+namespace stoat::util {
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::filesystem::path& path) {
+        close();
+
+#ifdef _WIN32
+        const auto file = CreateFileW(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+            nullptr
+        );
+
+        if (file == INVALID_HANDLE_VALUE) {
+            fmt::println(stderr, "failed to open file \"{}\"", path);
+            return false;
+        }
+
+        LARGE_INTEGER size{};
+
+        if (!GetFileSizeEx(file, &size)) {
+            fmt::println(stderr, "failed to get size of file \"{}\"", path);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_file = file;
+
+        // zero-length files cannot be mapped
+        if (size.QuadPart == 0) {
+            return true;
+        }
+
+        const auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (!mapping) {
+            fmt::println(stderr, "failed to map file \"{}\"", path);
+            close();
+            return false;
+        }
+
+        m_mapping = mapping;
+
+        const auto* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (!data) {
+            fmt::println(stderr, "failed to map file \"{}\"", path);
+            close();
+            return false;
+        }
+
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<usize>(size.QuadPart);
+#else
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            fmt::println(stderr, "failed to open file \"{}\"", path);
+            return false;
+        }
+
+        struct stat info{};
+
+        if (fstat(fd, &info)) {
+            fmt::println(stderr, "failed to get size of file \"{}\"", path);
+            ::close(fd);
+            return false;
+        }
+
+        // zero-length files cannot be mapped
+        if (info.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        const auto size = static_cast<usize>(info.st_size);
+        auto* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // the mapping holds its own reference to the file
+        ::close(fd);
+
+        if (data == MAP_FAILED) {
+            fmt::println(stderr, "failed to map file \"{}\"", path);
+            return false;
+        }
+
+        // accesses will be scattered, so readahead would mostly be wasted
+        madvise(data, size, MADV_RANDOM);
+
+        m_data = static_cast<const char*>(data);
+        m_size = size;
+#endif
+
+        return true;
+    }
+
+    void MappedFile::close() {
+#ifdef _WIN32
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+
+        if (m_file) {
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+#else
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+} // namespace stoat::util
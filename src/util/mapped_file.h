@@ -0,0 +1,52 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <filesystem>
+#include <span>
+
+namespace stoat::util {
+    // Read-only view of an entire file, mapped into memory
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+
+        [[nodiscard]] bool open(const std::filesystem::path& path);
+        void close();
+
+        [[nodiscard]] inline std::span<const char> data() const {
+            return {m_data, m_size};
+        }
+
+    private:
+        const char* m_data{};
+        usize m_size{};
+
+#ifdef _WIN32
+        void* m_file{};
+        void* m_mapping{};
+#endif
+    };
+} // namespace stoat::util
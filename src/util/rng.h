@@ -20,6 +20,7 @@
 
 #include "../types.h"
 
+#include <array>
 #include <bit>
 #include <limits>
 #include <random>
@@ -27,6 +28,8 @@
 namespace stoat::util::rng {
     class Jsf64Rng {
     public:
+        using State = std::array<u64, 4>;
+
         explicit constexpr Jsf64Rng(u64 seed) :
                 m_b{seed}, m_c{seed}, m_d{seed} {
             for (i32 i = 0; i < 20; ++i) {
@@ -83,11 +86,29 @@ namespace stoat::util::rng {
             return static_cast<u32>(m >> 32);
         }
 
+        [[nodiscard]] constexpr State state() const {
+            return {m_a, m_b, m_c, m_d};
+        }
+
+        // Continues exactly where the generator that produced the state left off
+        [[nodiscard]] static constexpr Jsf64Rng fromState(const State& state) {
+            Jsf64Rng rng{};
+
+            rng.m_a = state[0];
+            rng.m_b = state[1];
+            rng.m_c = state[2];
+            rng.m_d = state[3];
+
+            return rng;
+        }
+
     private:
+        constexpr Jsf64Rng() = default;
+
         u64 m_a{0xf1ea5eed};
-        u64 m_b;
-        u64 m_c;
-        u64 m_d;
+        u64 m_b{};
+        u64 m_c{};
+        u64 m_d{};
     };
 
     inline auto generateSingleSeed() {
@@ -0,0 +1,164 @@
+/*
+ * Stoat, a USI shogi engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * Stoat is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stoat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stoat. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <bit>
+
+#include "../arch.h"
+
+#if ST_HAS_SSE_BITBOARD
+    #include <immintrin.h>
+
+// Two-lane (64 + 64 bit) operations on SSE registers, used by Bitboard to
+// store its value when ST_SSE_BITBOARD is set. Square indices are unchanged -
+// squares 0-63 live in the low lane and 64-80 in the high one - so converting
+// to and from u128 (for raw() and constant evaluation) is a plain bit cast
+namespace stoat::util::sse {
+    using Vec = __m128i;
+
+    [[nodiscard]] constexpr Vec toVec(u128 v) {
+        return std::bit_cast<Vec>(v);
+    }
+
+    [[nodiscard]] constexpr u128 fromVec(Vec v) {
+        return std::bit_cast<u128>(v);
+    }
+
+    [[nodiscard]] inline u64 low(Vec v) {
+        return static_cast<u64>(_mm_cvtsi128_si64(v));
+    }
+
+    [[nodiscard]] inline u64 high(Vec v) {
+    #if __SSE4_1__
+        return static_cast<u64>(_mm_extract_epi64(v, 1));
+    #else
+        return static_cast<u64>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v)));
+    #endif
+    }
+
+    [[nodiscard]] inline Vec fromLanes(u64 high, u64 low) {
+        return _mm_set_epi64x(static_cast<i64>(high), static_cast<i64>(low));
+    }
+
+    [[nodiscard]] inline Vec bitAnd(Vec a, Vec b) {
+        return _mm_and_si128(a, b);
+    }
+
+    [[nodiscard]] inline Vec bitOr(Vec a, Vec b) {
+        return _mm_or_si128(a, b);
+    }
+
+    [[nodiscard]] inline Vec bitXor(Vec a, Vec b) {
+        return _mm_xor_si128(a, b);
+    }
+
+    // a & ~b
+    [[nodiscard]] inline Vec andNot(Vec a, Vec b) {
+        return _mm_andnot_si128(b, a);
+    }
+
+    [[nodiscard]] inline bool testZero(Vec v) {
+    #if __SSE4_1__
+        return _mm_testz_si128(v, v) != 0;
+    #else
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+    #endif
+    }
+
+    [[nodiscard]] inline bool equal(Vec a, Vec b) {
+        return testZero(_mm_xor_si128(a, b));
+    }
+
+    // shifts each lane separately, then carries the bits that fell out of one lane into the other
+    template <i32 kShift>
+    [[nodiscard]] inline Vec shiftLeft(Vec v) {
+        static_assert(kShift > 0 && kShift < 128);
+
+        if constexpr (kShift >= 64) {
+            return _mm_slli_epi64(_mm_slli_si128(v, 8), kShift - 64);
+        } else {
+            const auto shifted = _mm_slli_epi64(v, kShift);
+            const auto carry = _mm_slli_si128(_mm_srli_epi64(v, 64 - kShift), 8);
+            return _mm_or_si128(shifted, carry);
+        }
+    }
+
+    template <i32 kShift>
+    [[nodiscard]] inline Vec shiftRight(Vec v) {
+        static_assert(kShift > 0 && kShift < 128);
+
+        if constexpr (kShift >= 64) {
+            return _mm_srli_epi64(_mm_srli_si128(v, 8), kShift - 64);
+        } else {
+            const auto shifted = _mm_srli_epi64(v, kShift);
+            const auto carry = _mm_srli_si128(_mm_slli_epi64(v, 64 - kShift), 8);
+            return _mm_or_si128(shifted, carry);
+        }
+    }
+
+    template <i32 kShift>
+    [[nodiscard]] inline Vec shift(Vec v) {
+        if constexpr (kShift < 0) {
+            return shiftRight<-kShift>(v);
+        } else {
+            return shiftLeft<kShift>(v);
+        }
+    }
+
+    [[nodiscard]] inline i32 popcount(Vec v) {
+        return std::popcount(low(v)) + std::popcount(high(v));
+    }
+
+    [[nodiscard]] inline i32 ctz(Vec v) {
+        const auto l = low(v);
+        return l != 0 ? std::countr_zero(l) : 64 + std::countr_zero(high(v));
+    }
+
+    [[nodiscard]] inline bool multiple(Vec v) {
+        const auto l = low(v);
+        const auto h = high(v);
+        return ((l & (l - 1)) | (h & (h - 1))) != 0 || (l != 0 && h != 0);
+    }
+
+    // clears the lowest set bit, only touching the lane that contains it
+    [[nodiscard]] inline Vec clearLsb(Vec v) {
+        const auto l = low(v);
+
+        if (l != 0) {
+            return fromLanes(high(v), l & (l - 1));
+        } else {
+            const auto h = high(v);
+            return fromLanes(h & (h - 1), 0);
+        }
+    }
+
+    [[nodiscard]] inline Vec isolateLsb(Vec v) {
+        const auto l = low(v);
+
+        if (l != 0) {
+            return fromLanes(0, l & -l);
+        } else {
+            const auto h = high(v);
+            return fromLanes(h & -h, 0);
+        }
+    }
+} // namespace stoat::util::sse
+#endif